@@ -0,0 +1,337 @@
+/*
+ *  Write-ahead journal and checkpoints for closest-AVL trees.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "closest_AVL_journal.h"
+
+#define RECORD_SIZE 8
+#define OP_INSERT 'I'
+#define OP_DELETE 'D'
+#define CHECKPOINT_MAGIC "CAVLCKPT"
+#define CHECKPOINT_HEADER_SIZE 16
+#define IO_CHUNK 65536
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+/*
+ * Returns the check byte of a record, so that garbage left by a torn
+ * write is not mistaken for an operation.
+ */
+unsigned char recordCheck(unsigned char op, int key) {
+  uint32_t k = (uint32_t) key;
+  return op ^ (k & 0xff) ^ ((k >> 8) & 0xff) ^ ((k >> 16) & 0xff) ^
+    (k >> 24) ^ 0x5a;
+}
+
+/*
+ * Writes all 'length' bytes of 'data' to 'fd', retrying short writes.
+ * Returns true on success.
+ */
+bool writeAll(int fd, const void * data, size_t length) {
+  const unsigned char * p = data;
+  while (length > 0) {
+    ssize_t written = write(fd, p, length);
+    if (written < 0) {
+      return false;
+    }
+    p += written;
+    length -= written;
+  }
+  return true;
+}
+
+/*
+ * Appends a record to the journal, committing the batch if it is full.
+ * Returns false, without buffering it, if the journal has failed.
+ */
+bool logOperation(closest_AVL_Journal * journal, unsigned char op, int key) {
+  // After a failed commit the batch may still be full.
+  if (journal -> failed) {
+    return false;
+  }
+  unsigned char * record = journal -> buffer + journal -> buffered * RECORD_SIZE;
+  record[0] = op;
+  record[1] = recordCheck(op, key);
+  record[2] = 0;
+  record[3] = 0;
+  memcpy(record + 4, & key, sizeof(int));
+  journal -> buffered++;
+  if (journal -> buffered == journal -> batchSize) {
+    journalSync(journal);
+  }
+  return true;
+}
+
+// fsyncs the directory containing 'path', so a rename into it is durable.
+void syncParentDirectory(const char * path) {
+  const char * slash = strrchr(path, '/');
+  char * dir = (slash == NULL) ? strdup(".") : strndup(path, slash - path + 1);
+  int fd = open(dir, O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+  free(dir);
+}
+
+typedef struct checkpoint_writer {
+  int fd;
+  int buffered;
+  long long count;
+  bool ok;
+  int keys[IO_CHUNK / sizeof(int)];
+} CheckpointWriter;
+
+// Appends the keys of the tree rooted at 'node' in order.
+void writeKeysInorder(CheckpointWriter * writer, closest_AVL_Node * node) {
+  if (node == NULL) {
+    return;
+  }
+  writeKeysInorder(writer, node -> left);
+  writer -> keys[writer -> buffered++] = node -> key;
+  writer -> count++;
+  if (writer -> buffered == IO_CHUNK / sizeof(int)) {
+    writer -> ok = writer -> ok && writeAll(writer -> fd, writer -> keys,
+      sizeof(writer -> keys));
+    writer -> buffered = 0;
+  }
+  writeKeysInorder(writer, node -> right);
+}
+
+/*
+ * Loads the checkpoint at 'path' into a new tree stored in 'root' (NULL
+ * if there is no checkpoint file yet). Returns false if the checkpoint
+ * exists but cannot be read or is corrupt: a bad magic, a truncated file
+ * or a key count that does not match its size.
+ */
+bool loadCheckpoint(const char * path, closest_AVL_Node ** root) {
+  * root = NULL;
+  FILE * f = fopen(path, "rb");
+  if (f == NULL) {
+    return errno == ENOENT;
+  }
+
+  // The header says how many keys follow; check it against the file size
+  // before trusting it with a cast to int and an allocation.
+  char header[CHECKPOINT_HEADER_SIZE];
+  long long count = 0;
+  struct stat st;
+  bool ok = fstat(fileno(f), & st) == 0 &&
+    fread(header, 1, CHECKPOINT_HEADER_SIZE, f) == CHECKPOINT_HEADER_SIZE &&
+    memcmp(header, CHECKPOINT_MAGIC, 8) == 0;
+  if (ok) {
+    memcpy( & count, header + 8, sizeof(long long));
+    ok = count >= 0 && count <= INT_MAX &&
+      st.st_size == CHECKPOINT_HEADER_SIZE + count * (long long) sizeof(int);
+  }
+  if (ok) {
+    int * keys = malloc(sizeof(int) * (count > 0 ? count : 1));
+    ok = keys != NULL && fread(keys, sizeof(int), count, f) == (size_t) count;
+    if (ok) {
+      // Checkpoints are written in order, so the tree is built in O(n).
+      * root = buildTreeFromSorted(keys, NULL, (int) count);
+    }
+    free(keys);
+  }
+  fclose(f);
+  return ok;
+}
+
+/*************************************************************************
+ ** Journal operations
+ *************************************************************************/
+
+closest_AVL_Journal * openJournal(const char * logPath,
+  const char * checkpointPath, int batchSize, long checkpointInterval) {
+  int fd = open(logPath, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  off_t committed = lseek(fd, 0, SEEK_END);
+
+  closest_AVL_Journal * journal = malloc(sizeof(closest_AVL_Journal));
+  if (committed < 0 || journal == NULL) {
+    close(fd);
+    free(journal);
+    return NULL;
+  }
+  journal -> logFd = fd;
+  journal -> checkpointPath = strdup(checkpointPath);
+  journal -> batchSize = (batchSize > 0) ? batchSize : 1;
+  journal -> buffer = malloc((size_t) journal -> batchSize * RECORD_SIZE);
+  journal -> buffered = 0;
+  journal -> opsSinceCheckpoint = 0;
+  journal -> checkpointInterval = checkpointInterval;
+  journal -> committed = committed;
+  journal -> failed = false;
+  if (journal -> checkpointPath == NULL || journal -> buffer == NULL) {
+    closeJournal(journal);
+    return NULL;
+  }
+  return journal;
+}
+
+bool recoverTree(closest_AVL_Journal * journal, closest_AVL_Node ** tree) {
+  // Replaying the log onto an empty tree in place of a corrupt checkpoint
+  // would silently lose every key saved in it, so we give up instead.
+  closest_AVL_Node * root;
+  if (!loadCheckpoint(journal -> checkpointPath, & root)) {
+    * tree = NULL;
+    return false;
+  }
+
+  // Replay the log. Operations are set updates, so replaying records that
+  // are already reflected in the checkpoint is harmless.
+  unsigned char chunk[IO_CHUNK];
+  off_t offset = 0;
+  bool torn = false;
+  ssize_t got;
+  while (!torn && (got = pread(journal -> logFd, chunk, IO_CHUNK, offset)) > 0) {
+    ssize_t complete = got - got % RECORD_SIZE;
+    if (complete == 0) {
+      torn = true;
+    }
+    for (ssize_t i = 0; i < complete && !torn; i += RECORD_SIZE) {
+      int key;
+      memcpy( & key, chunk + i + 4, sizeof(int));
+      if (chunk[i + 1] != recordCheck(chunk[i], key)) {
+        torn = true;
+      } else if (chunk[i] == OP_INSERT) {
+        root = insert(root, key, NULL);
+      } else if (chunk[i] == OP_DELETE) {
+        root = delete(root, key);
+      } else {
+        torn = true;
+      }
+      if (!torn) {
+        offset += RECORD_SIZE;
+        journal -> opsSinceCheckpoint++;
+      }
+    }
+  }
+
+  // Drop a torn tail, so new records are not appended after garbage; if
+  // that fails, they would be lost on the next recovery.
+  if (torn && (ftruncate(journal -> logFd, offset) != 0 ||
+      fsync(journal -> logFd) != 0)) {
+    journal -> failed = true;
+  }
+  journal -> committed = offset;
+  * tree = root;
+  return true;
+}
+
+closest_AVL_Node * journaledInsert(closest_AVL_Journal * journal,
+  closest_AVL_Node * root, int key, void * value) {
+  if (!logOperation(journal, OP_INSERT, key)) {
+    return root;
+  }
+  root = insert(root, key, value);
+  if (journal -> checkpointInterval > 0 &&
+    ++journal -> opsSinceCheckpoint >= journal -> checkpointInterval) {
+    checkpointTree(journal, root);
+  }
+  return root;
+}
+
+closest_AVL_Node * journaledDelete(closest_AVL_Journal * journal,
+  closest_AVL_Node * root, int key) {
+  if (!logOperation(journal, OP_DELETE, key)) {
+    return root;
+  }
+  root = delete(root, key);
+  if (journal -> checkpointInterval > 0 &&
+    ++journal -> opsSinceCheckpoint >= journal -> checkpointInterval) {
+    checkpointTree(journal, root);
+  }
+  return root;
+}
+
+bool journalSync(closest_AVL_Journal * journal) {
+  if (journal -> buffered == 0) {
+    return !journal -> failed;
+  }
+  size_t length = (size_t) journal -> buffered * RECORD_SIZE;
+  if (writeAll(journal -> logFd, journal -> buffer, length) &&
+    fdatasync(journal -> logFd) == 0) {
+    journal -> committed += length;
+    journal -> buffered = 0;
+  } else {
+    // Cut off any part of the batch that was written, so that a torn
+    // record does not hide the records committed after it; the batch is
+    // kept, to be written again by the next call.
+    journal -> failed = true;
+    if (ftruncate(journal -> logFd, journal -> committed) == 0) {
+      fsync(journal -> logFd);
+    }
+  }
+  return !journal -> failed;
+}
+
+bool checkpointTree(closest_AVL_Journal * journal, closest_AVL_Node * root) {
+  // The log must hold every operation up to this point before it may be
+  // discarded: if we crash after the rename but before the truncation,
+  // recovery replays it on top of the new checkpoint.
+  if (!journalSync(journal)) {
+    return false;
+  }
+
+  size_t pathLength = strlen(journal -> checkpointPath);
+  char * tmpPath = malloc(pathLength + 5);
+  memcpy(tmpPath, journal -> checkpointPath, pathLength);
+  memcpy(tmpPath + pathLength, ".tmp", 5);
+
+  CheckpointWriter * writer = malloc(sizeof(CheckpointWriter));
+  writer -> fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  writer -> buffered = 0;
+  writer -> count = 0;
+  writer -> ok = writer -> fd >= 0;
+
+  if (writer -> ok) {
+    char header[CHECKPOINT_HEADER_SIZE] = CHECKPOINT_MAGIC;
+    writer -> ok = writeAll(writer -> fd, header, CHECKPOINT_HEADER_SIZE);
+    writeKeysInorder(writer, root);
+    writer -> ok = writer -> ok && writeAll(writer -> fd, writer -> keys,
+      writer -> buffered * sizeof(int));
+    // The key count is only known now; fill it into the header.
+    writer -> ok = writer -> ok && pwrite(writer -> fd, & writer -> count,
+      sizeof(long long), 8) == sizeof(long long);
+    writer -> ok = writer -> ok && fsync(writer -> fd) == 0;
+    close(writer -> fd);
+  }
+
+  bool ok = writer -> ok && rename(tmpPath, journal -> checkpointPath) == 0;
+  if (ok) {
+    syncParentDirectory(journal -> checkpointPath);
+    // If this fails the old records stay behind, which recovery tolerates.
+    if (ftruncate(journal -> logFd, 0) == 0) {
+      fsync(journal -> logFd);
+      journal -> committed = 0;
+    }
+    journal -> opsSinceCheckpoint = 0;
+  } else {
+    unlink(tmpPath);
+  }
+
+  free(writer);
+  free(tmpPath);
+  return ok;
+}
+
+bool closeJournal(closest_AVL_Journal * journal) {
+  bool ok = journalSync(journal);
+  close(journal -> logFd);
+  free(journal -> checkpointPath);
+  free(journal -> buffer);
+  free(journal);
+  return ok;
+}
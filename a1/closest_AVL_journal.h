@@ -0,0 +1,95 @@
+/*
+ *  Header file for the write-ahead journal of closest-AVL trees.
+ *
+ *  A journal is an append-only binary log of insert/delete operations plus
+ *  a checkpoint file holding every key of the tree at some point in time.
+ *  Log records are buffered and written with a single write + fsync per
+ *  batch (group commit), so an operation is durable once its batch has
+ *  been committed. Recovery loads the checkpoint and replays the log tail.
+ *
+ *  Only keys are made durable: values are pointers into the process that
+ *  wrote them, so recovered nodes always have NULL values.
+ *
+ *  Errors are sticky: a failed commit cuts the log back to its last
+ *  committed record, keeps the batch in memory and sets 'failed'. From
+ *  then on no operation is logged or applied, and journalSync,
+ *  checkpointTree and closeJournal return false; recover the tree from
+ *  the files to go on.
+ */
+
+#include <sys/types.h>
+
+#include "closest_AVL_tree.h"
+
+#ifndef __closest_AVL_journal_header
+#define __closest_AVL_journal_header
+
+typedef struct closest_AVL_journal
+{
+  int logFd;                // file descriptor of the operation log
+  char* checkpointPath;     // where checkpoints are written
+  unsigned char* buffer;    // records waiting for the next group commit
+  int buffered;             // number of records in 'buffer'
+  int batchSize;            // number of records per group commit
+  long opsSinceCheckpoint;  // operations logged since the last checkpoint
+  long checkpointInterval;  // checkpoint every this many ops; 0 = never
+  off_t committed;          // size of the log up to its last whole commit
+  bool failed;              // a commit failed; nothing is logged any more
+} closest_AVL_Journal;
+
+/*
+ * Opens (creating if needed) the journal made of the log at 'logPath' and
+ * the checkpoint at 'checkpointPath'. Records are committed 'batchSize' at
+ * a time, and a checkpoint is taken automatically after every
+ * 'checkpointInterval' operations (never if 0). Returns NULL on failure.
+ */
+closest_AVL_Journal* openJournal(const char* logPath,
+    const char* checkpointPath, int batchSize, long checkpointInterval);
+
+/*
+ * Rebuilds the tree saved in 'journal': loads the last checkpoint, then
+ * replays every complete log record written after it. A torn record at the
+ * end of the log (from a crash mid-write) is discarded. Stores the root of
+ * the recovered tree in 'root' (NULL if the journal is empty) and returns
+ * true. Returns false, with 'root' NULL, if the checkpoint exists but is
+ * corrupt or unreadable; a missing checkpoint just means an empty tree.
+ */
+bool recoverTree(closest_AVL_Journal* journal, closest_AVL_Node** root);
+
+/*
+ * Same as 'insert', but logs the operation first. Returns the new root.
+ * If the journal has already failed, the tree is left unchanged; if the
+ * commit of the batch fails here, the operation stays in it and is applied
+ * (see 'failed').
+ */
+closest_AVL_Node* journaledInsert(closest_AVL_Journal* journal,
+    closest_AVL_Node* root, int key, void* value);
+
+/*
+ * Same as 'delete', but logs the operation first. Returns the new root.
+ * Fails like journaledInsert.
+ */
+closest_AVL_Node* journaledDelete(closest_AVL_Journal* journal,
+    closest_AVL_Node* root, int key);
+
+/*
+ * Commits all buffered records: writes them to the log and fsyncs it.
+ * Returns true iff no error has occurred (see 'failed'). After a failure
+ * the records stay buffered, and each call tries to commit them again.
+ */
+bool journalSync(closest_AVL_Journal* journal);
+
+/*
+ * Writes every key of the tree rooted at 'root' to a new checkpoint,
+ * atomically replaces the old one and empties the log. Returns true on
+ * success; on failure the previous checkpoint and log are left intact.
+ */
+bool checkpointTree(closest_AVL_Journal* journal, closest_AVL_Node* root);
+
+/*
+ * Commits any buffered records and frees 'journal'. Returns the result of
+ * the commit.
+ */
+bool closeJournal(closest_AVL_Journal* journal);
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ *  Recovery tests for the closest-AVL journal: random operations are
+ *  journaled and checked against a plain array of flags, then the journal
+ *  is recovered after a clean close, after a torn write at the end of the
+ *  log, with a corrupt checkpoint, which recovery must refuse, and after a
+ *  commit that failed halfway.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "closest_AVL_journal.h"
+
+#define KEY_RANGE 5000
+#define OPERATIONS 20000
+#define BATCH 64
+
+char logPath[] = "/tmp/closest_AVL_journal_XXXXXX";
+char checkpointPath[sizeof(logPath) + 5];
+bool model[KEY_RANGE];  // model[k] is true if key k is in the tree
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/*
+ * Returns true if the tree rooted at 'root' holds exactly the keys of the
+ * model.
+ */
+bool matchesModel(closest_AVL_Node* root)
+{
+  int count = 0;
+  for (int key = 0; key < KEY_RANGE; key++)
+  {
+    if ((search(root, key) != NULL) != model[key])
+    {
+      return false;
+    }
+    count += model[key];
+  }
+  int size = 0;
+  closest_AVL_Node* stack[MAX_AVL_HEIGHT];
+  int depth = 0;
+  for (closest_AVL_Node* node = root; node != NULL || depth > 0;)
+  {
+    if (node != NULL)
+    {
+      stack[depth++] = node;
+      node = node->left;
+    }
+    else
+    {
+      node = stack[--depth]->right;
+      size++;
+    }
+  }
+  return size == count;
+}
+
+/*
+ * Applies 'count' random journaled operations to 'root', mirroring them in
+ * the model, and returns the new root.
+ */
+closest_AVL_Node* randomOperations(closest_AVL_Journal* journal,
+    closest_AVL_Node* root, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    int key = rand() % KEY_RANGE;
+    if (rand() % 3 != 0)
+    {
+      root = journaledInsert(journal, root, key, NULL);
+      model[key] = true;
+    }
+    else
+    {
+      root = journaledDelete(journal, root, key);
+      model[key] = false;
+    }
+  }
+  return root;
+}
+
+// Reopens the journal and recovers it; returns whether recovery succeeded.
+bool reopen(closest_AVL_Journal** journal, closest_AVL_Node** root)
+{
+  *journal = openJournal(logPath, checkpointPath, BATCH, 0);
+  return *journal != NULL && recoverTree(*journal, root);
+}
+
+// Appends 'length' bytes of 'data' to the file at 'path'.
+void appendBytes(const char* path, const void* data, size_t length)
+{
+  int fd = open(path, O_WRONLY | O_APPEND);
+  check(fd >= 0 && write(fd, data, length) == (ssize_t) length, "append");
+  close(fd);
+}
+
+// Overwrites 'length' bytes of the file at 'path' at 'offset'.
+void patchBytes(const char* path, off_t offset, const void* data,
+    size_t length)
+{
+  int fd = open(path, O_WRONLY);
+  check(fd >= 0 && pwrite(fd, data, length, offset) == (ssize_t) length,
+      "patch");
+  close(fd);
+}
+
+off_t fileSize(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  off_t size = lseek(fd, 0, SEEK_END);
+  close(fd);
+  return size;
+}
+
+int main()
+{
+  srand(1);
+  int fd = mkstemp(logPath);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Unable to create a temporary log file\n");
+    return 1;
+  }
+  close(fd);
+  snprintf(checkpointPath, sizeof(checkpointPath), "%s.ckpt", logPath);
+
+  // 1. Log only (no checkpoint yet), then a checkpoint plus a log tail.
+  closest_AVL_Node* root = NULL;
+  closest_AVL_Journal* journal = NULL;
+  check(reopen(&journal, &root) && root == NULL, "recover empty journal");
+  root = randomOperations(journal, root, OPERATIONS);
+  closeJournal(journal);
+  deleteTree(root);
+  check(reopen(&journal, &root) && matchesModel(root), "recover log only");
+
+  check(checkpointTree(journal, root), "checkpoint");
+  root = randomOperations(journal, root, OPERATIONS);
+  closeJournal(journal);
+  deleteTree(root);
+  check(reopen(&journal, &root) && matchesModel(root),
+      "recover checkpoint and log");
+  closeJournal(journal);
+  deleteTree(root);
+
+  // 2. A torn tail: a record with a bad check byte, then half a record.
+  // Both are dropped and the log is cut back to its last whole record.
+  off_t logSize = fileSize(logPath);
+  unsigned char garbage[12] = { 'I', 0, 0, 0, 1, 2, 3, 4, 'D', 7, 0, 0 };
+  appendBytes(logPath, garbage, sizeof(garbage));
+  check(reopen(&journal, &root) && matchesModel(root), "recover torn tail");
+  check(fileSize(logPath) == logSize, "torn tail truncated");
+  root = randomOperations(journal, root, OPERATIONS / 10);
+  closeJournal(journal);
+  deleteTree(root);
+  check(reopen(&journal, &root) && matchesModel(root),
+      "recover after torn tail");
+  check(checkpointTree(journal, root), "checkpoint");
+  closeJournal(journal);
+  deleteTree(root);
+
+  // 3. Corrupt checkpoints must fail recovery rather than leave the tree
+  // empty. Each case damages a copy of the good checkpoint.
+  off_t checkpointSize = fileSize(checkpointPath);
+  char* good = malloc(checkpointSize);
+  fd = open(checkpointPath, O_RDONLY);
+  check(read(fd, good, checkpointSize) == checkpointSize, "read checkpoint");
+  close(fd);
+
+  long long counts[3] = { -1, (long long) INT_MAX + 1,
+    (checkpointSize - 16) / (long long) sizeof(int) + 1 };
+  for (int i = 0; i < 5; i++)
+  {
+    fd = open(checkpointPath, O_WRONLY | O_TRUNC);
+    check(write(fd, good, checkpointSize) == checkpointSize, "restore");
+    close(fd);
+    if (i == 0)
+    {
+      patchBytes(checkpointPath, 0, "XAVLCKPT", 8);  // bad magic
+    }
+    else if (i == 1)
+    {
+      check(truncate(checkpointPath, checkpointSize - 2) == 0, "truncate");
+    }
+    else
+    {
+      patchBytes(checkpointPath, 8, &counts[i - 2], sizeof(long long));
+    }
+    check(!reopen(&journal, &root) && root == NULL,
+        "reject corrupt checkpoint");
+    if (journal != NULL)
+    {
+      closeJournal(journal);
+    }
+  }
+  free(good);
+
+  // A missing checkpoint is not corrupt: the log alone is replayed.
+  unlink(checkpointPath);
+  check(reopen(&journal, &root), "recover without checkpoint");
+  closeJournal(journal);
+  deleteTree(root);
+
+  // 4. A file size limit cuts a commit short. The log must be cut back to
+  // the last whole commit and nothing more may be logged; the failed batch
+  // is written on close, once the limit is lifted, but still reported.
+  check(truncate(logPath, 0) == 0, "empty the log");
+  memset(model, 0, sizeof(model));
+  check(reopen(&journal, &root) && root == NULL, "recover empty log");
+  off_t limitSize = 3 * BATCH * 8 + 20;
+  struct rlimit limit;
+  struct rlimit small;
+  signal(SIGXFSZ, SIG_IGN);
+  getrlimit(RLIMIT_FSIZE, &limit);
+  small = limit;
+  small.rlim_cur = limitSize;
+  setrlimit(RLIMIT_FSIZE, &small);
+  for (int i = 0; i < OPERATIONS && !journal->failed; i++)
+  {
+    root = randomOperations(journal, root, 1);
+  }
+  check(journal->failed && journal->committed == limitSize - 20 &&
+      fileSize(logPath) == journal->committed, "cut back a failed commit");
+  root = journaledInsert(journal, root, KEY_RANGE, NULL);
+  check(search(root, KEY_RANGE) == NULL && !journalSync(journal) &&
+      !checkpointTree(journal, root), "refuse to go on after a failure");
+  setrlimit(RLIMIT_FSIZE, &limit);
+  check(!closeJournal(journal), "report the failure on close");
+  deleteTree(root);
+  check(reopen(&journal, &root) && matchesModel(root),
+      "recover after a failed commit");
+  closeJournal(journal);
+  deleteTree(root);
+
+  unlink(checkpointPath);
+  unlink(logPath);
+  if (failures > 0)
+  {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("All journal recovery tests passed\n");
+  return 0;
+}
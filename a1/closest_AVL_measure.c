@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "closest_AVL_tree.h"
+#include "closest_trie.h"
+#include "closest_pma.h"
+
+// Function prototypes
+void fillZipfTrace(int trace[], int traceSize, int keys[], int numKeys, double s);
+double measureAVL(closest_AVL_Node* root, int trace[], int traceSize);
+double measureSplay(closest_AVL_Node** root, int trace[], int traceSize);
+void comparePredecessor(int numKeys, int universeBits, int trace[], int traceSize);
+double measureFloorAVL(closest_AVL_Node* root, int trace[], int traceSize, long* sum);
+double measureTriePredecessor(ClosestTrie* trie, int trace[], int traceSize, long* sum);
+void comparePMA(int numKeys, int numScans, int scanWidth);
+int scanAVL(closest_AVL_Node* node, int lo, int hi, int keys[], int count);
+int compareInts(const void* a, const void* b);
+double now(void);
+
+/*
+ * Compares AVL 'search' with 'splaySearch' on lookup traces whose keys
+ * follow a Zipf distribution with exponent s (s = 0 is uniform), then AVL
+ * 'floorNode' with 'triePredecessor' on uniform predecessor queries, and
+ * finally the AVL tree with the packed memory array on inserts and range
+ * scans.
+ */
+int main() {
+    int sizes[] = {100000, 1000000};
+    double exponents[] = {0.0, 0.8, 1.0, 1.2};
+    int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+    int numExponents = sizeof(exponents) / sizeof(exponents[0]);
+    int traceSize = 2000000;
+    int* trace = (int*)malloc(traceSize * sizeof(int));
+
+    srand(63);
+    for (int i = 0; i < numSizes; i++) {
+        int size = sizes[i];
+        int* keys = (int*)malloc(size * sizeof(int));
+        for (int k = 0; k < size; k++) {
+            keys[k] = 2 * k;
+        }
+
+        for (int j = 0; j < numExponents; j++) {
+            fillZipfTrace(trace, traceSize, keys, size, exponents[j]);
+
+            closest_AVL_Node* avl = buildTreeFromSorted(keys, NULL, size);
+            double timeAVL = measureAVL(avl, trace, traceSize);
+            deleteTree(avl);
+
+            closest_AVL_Node* splayed = buildTreeFromSorted(keys, NULL, size);
+            double timeSplay = measureSplay(&splayed, trace, traceSize);
+            deleteTree(splayed);
+
+            printf("Keys: %d, Zipf s: %.1f, AVL Time: %f, Splay Time: %f\n",
+                   size, exponents[j], timeAVL, timeSplay);
+        }
+
+        free(keys);
+    }
+
+    int universes[] = {24, 30};
+    for (int i = 0; i < numSizes; i++) {
+        for (int j = 0; j < 2; j++) {
+            comparePredecessor(sizes[i], universes[j], trace, traceSize);
+        }
+    }
+
+    for (int i = 0; i < numSizes; i++) {
+        comparePMA(sizes[i], 1000, 1 << 14);
+    }
+
+    free(trace);
+    return 0;
+}
+
+/*
+ * Fills 'trace' with keys drawn from 'keys' so that the key of popularity
+ * rank r is drawn with probability proportional to 1 / r^s. Ranks are
+ * assigned to keys at random, so hot keys are spread over the tree.
+ */
+void fillZipfTrace(int trace[], int traceSize, int keys[], int numKeys, double s) {
+    double* cdf = (double*)malloc(numKeys * sizeof(double));
+    int* rankToKey = (int*)malloc(numKeys * sizeof(int));
+    double total = 0.0;
+    for (int r = 0; r < numKeys; r++) {
+        total += 1.0 / pow(r + 1, s);
+        cdf[r] = total;
+        rankToKey[r] = keys[r];
+    }
+    for (int r = numKeys - 1; r > 0; r--) {
+        int other = rand() % (r + 1);
+        int temp = rankToKey[r];
+        rankToKey[r] = rankToKey[other];
+        rankToKey[other] = temp;
+    }
+
+    for (int i = 0; i < traceSize; i++) {
+        double u = (double)rand() / RAND_MAX * total;
+        int lo = 0;
+        int hi = numKeys - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        trace[i] = rankToKey[lo];
+    }
+
+    free(cdf);
+    free(rankToKey);
+}
+
+double measureAVL(closest_AVL_Node* root, int trace[], int traceSize) {
+    long found = 0;
+    double start = now();
+    for (int i = 0; i < traceSize; i++) {
+        found += search(root, trace[i]) != NULL;
+    }
+    double elapsed = now() - start;
+    if (found != traceSize) {
+        fprintf(stderr, "AVL search missed %ld keys\n", traceSize - found);
+    }
+    return elapsed;
+}
+
+double measureSplay(closest_AVL_Node** root, int trace[], int traceSize) {
+    long found = 0;
+    double start = now();
+    for (int i = 0; i < traceSize; i++) {
+        found += splaySearch(root, trace[i]) != NULL;
+    }
+    double elapsed = now() - start;
+    if (found != traceSize) {
+        fprintf(stderr, "Splay search missed %ld keys\n", traceSize - found);
+    }
+    return elapsed;
+}
+
+/*
+ * Builds an AVL tree and a trie over the same 'numKeys' random keys in
+ * [0, 2^universeBits) and times predecessor queries on both.
+ */
+void comparePredecessor(int numKeys, int universeBits, int trace[], int traceSize) {
+    int mask = (1 << universeBits) - 1;
+    int* keys = (int*)malloc(numKeys * sizeof(int));
+    for (int k = 0; k < numKeys; k++) {
+        keys[k] = (int)(((unsigned)rand() << 16) ^ rand()) & mask;
+    }
+    qsort(keys, numKeys, sizeof(int), compareInts);
+    int unique = 0;
+    for (int k = 0; k < numKeys; k++) {
+        if (unique == 0 || keys[k] != keys[unique - 1]) {
+            keys[unique++] = keys[k];
+        }
+    }
+    for (int i = 0; i < traceSize; i++) {
+        trace[i] = (int)(((unsigned)rand() << 16) ^ rand()) & mask;
+    }
+
+    closest_AVL_Node* avl = buildTreeFromSorted(keys, NULL, unique);
+    ClosestTrie* trie = newClosestTrie(0, universeBits);
+    for (int k = 0; k < unique; k++) {
+        trieInsert(trie, keys[k], NULL);
+    }
+
+    long sumAVL = 0;
+    long sumTrie = 0;
+    double timeAVL = measureFloorAVL(avl, trace, traceSize, &sumAVL);
+    double timeTrie = measureTriePredecessor(trie, trace, traceSize, &sumTrie);
+    if (sumAVL != sumTrie) {
+        fprintf(stderr, "Predecessor results differ\n");
+    }
+    printf("Keys: %d, Universe: 2^%d, AVL floor Time: %f, Trie Time: %f\n",
+           unique, universeBits, timeAVL, timeTrie);
+
+    deleteTree(avl);
+    deleteClosestTrie(trie);
+    free(keys);
+}
+
+// Both measure the largest key < q, summing the results as a checksum.
+double measureFloorAVL(closest_AVL_Node* root, int trace[], int traceSize, long* sum) {
+    double start = now();
+    for (int i = 0; i < traceSize; i++) {
+        closest_AVL_Node* node = floorNode(root, trace[i] - 1);
+        *sum += (node != NULL) ? node->key : -1;
+    }
+    return now() - start;
+}
+
+double measureTriePredecessor(ClosestTrie* trie, int trace[], int traceSize, long* sum) {
+    double start = now();
+    for (int i = 0; i < traceSize; i++) {
+        int result;
+        *sum += triePredecessor(trie, trace[i], &result) ? result : -1;
+    }
+    return now() - start;
+}
+
+/*
+ * Inserts the same 'numKeys' random keys into an AVL tree and a packed
+ * memory array, then runs 'numScans' range scans of 'scanWidth' keys wide.
+ */
+void comparePMA(int numKeys, int numScans, int scanWidth) {
+    int* keys = (int*)malloc(numKeys * sizeof(int));
+    int* out = (int*)malloc(numKeys * sizeof(int));
+    for (int k = 0; k < numKeys; k++) {
+        keys[k] = (int)(((unsigned)rand() << 16) ^ rand()) & 0x3fffffff;
+    }
+
+    closest_AVL_Node* avl = NULL;
+    double start = now();
+    for (int k = 0; k < numKeys; k++) {
+        avl = insert(avl, keys[k], NULL);
+    }
+    double insertAVL = now() - start;
+
+    ClosestPMA* pma = newPMA();
+    start = now();
+    for (int k = 0; k < numKeys; k++) {
+        pmaInsert(pma, keys[k], NULL);
+    }
+    double insertPMA = now() - start;
+
+    // Scale the width so that a scan returns about 'scanWidth' keys.
+    int width = (int)((double)scanWidth / numKeys * 0x40000000);
+    long sumAVL = 0;
+    long sumPMA = 0;
+    start = now();
+    for (int i = 0; i < numScans; i++) {
+        int lo = keys[i % numKeys];
+        sumAVL += scanAVL(avl, lo, lo + width, out, 0);
+    }
+    double scanTimeAVL = now() - start;
+    start = now();
+    for (int i = 0; i < numScans; i++) {
+        int lo = keys[i % numKeys];
+        sumPMA += pmaRangeScan(pma, lo, lo + width, out, numKeys);
+    }
+    double scanTimePMA = now() - start;
+    if (sumAVL != sumPMA) {
+        fprintf(stderr, "Range scan results differ\n");
+    }
+
+    printf("Keys: %d, AVL Insert Time: %f, PMA Insert Time: %f, "
+           "AVL Scan Time: %f, PMA Scan Time: %f\n",
+           numKeys, insertAVL, insertPMA, scanTimeAVL, scanTimePMA);
+
+    deleteTree(avl);
+    deletePMA(pma);
+    free(keys);
+    free(out);
+}
+
+// Appends the keys in [lo, hi] to 'keys' from 'count' on; returns the new count.
+int scanAVL(closest_AVL_Node* node, int lo, int hi, int keys[], int count) {
+    if (node == NULL) {
+        return count;
+    }
+    if (node->key > lo) {
+        count = scanAVL(node->left, lo, hi, keys, count);
+    }
+    if (node->key >= lo && node->key <= hi) {
+        keys[count++] = node->key;
+    }
+    if (node->key < hi) {
+        count = scanAVL(node->right, lo, hi, keys, count);
+    }
+    return count;
+}
+
+int compareInts(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Wall-clock seconds from a monotonic clock.
+double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
@@ -4,8 +4,61 @@
  *  Based on materials developed by Anya Tafliovich and F. Estrada.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
 #include "closest_AVL_tree.h"
 
+// When true, insert/delete defer closest-pair maintenance (see header).
+static bool lazyAugmentation = false;
+
+// Set operations fork a thread per recursion level up to this depth.
+static int setOperationForkDepth = 0;
+
+// Subtrees lower than this are not worth a thread of their own.
+#define SET_OPERATION_FORK_HEIGHT 12
+
+/*
+ * Header of an arena made by 'relayout', at the start of its block. Nodes
+ * in the arena point to it; they and their pairs are never passed to
+ * free(), and the block is freed once its last node is deleted.
+ */
+typedef struct closest_AVL_arena {
+  atomic_long live; // arena nodes not deleted yet
+  pair * pairs;     // the arena's pairs, 'size' of them
+  long size;
+} RelayoutArena;
+
+// Room for the arena header, so the nodes after it start on a cache line.
+#define RELAYOUT_ARENA_HEADER 64
+
+/*************************************************************************
+ ** Relayout arenas
+ *************************************************************************/
+
+// Frees the closest pair of 'node', unless it lives in the node's arena.
+void freePair(closest_AVL_Node * node) {
+  pair * p = node -> closest_pair;
+  RelayoutArena * arena = node -> arena;
+  if (arena != NULL && p >= arena -> pairs &&
+    p < arena -> pairs + arena -> size) {
+    return;
+  }
+  free(p);
+}
+
+// Frees a node, or returns it to its arena (freeing the arena if empty).
+// Nodes may be freed from several threads at once (see set operations).
+void freeNode(closest_AVL_Node * node) {
+  RelayoutArena * arena = node -> arena;
+  if (arena == NULL) {
+    free(node);
+  } else if (atomic_fetch_sub( & arena -> live, 1) == 1) {
+    free(arena);
+  }
+}
+
 /*************************************************************************
  ** Suggested helper functions -- part of starter code
  *************************************************************************/
@@ -88,11 +141,18 @@ void updateMax(closest_AVL_Node * node) {
  * values from its children. Note: this should be an O(1) operation.
  */
 void updateClosestPair(closest_AVL_Node * node) {
+  node -> dirty = false;
   if (node -> left == NULL && node -> right == NULL) {
+    freePair(node);
     node -> closest_pair = NULL;
     return;
   }
 
+  // Children left dirty by lazy augmentation must be brought up to date
+  // before their closest pairs can be read.
+  refreshTree(node -> left);
+  refreshTree(node -> right);
+
   // Find the closest pair from the left subtree.
   // Compair the closest pair from the left subtree with
   // the pair of the maximum key of the left subtree and the root.
@@ -149,11 +209,16 @@ void updateClosestPair(closest_AVL_Node * node) {
 }
 
 // Updates all the attributes of a node.
+// With lazy augmentation, the closest pair is only marked as stale.
 void updateAll(closest_AVL_Node * node) {
   updateHeight(node);
   updateMax(node);
   updateMin(node);
-  updateClosestPair(node);
+  if (lazyAugmentation) {
+    node -> dirty = true;
+  } else {
+    updateClosestPair(node);
+  }
 }
 
 /*
@@ -252,8 +317,10 @@ closest_AVL_Node * createNode(int key, void * value) {
   node -> min = key;
   node -> max = key;
   node -> closest_pair = NULL;
+  node -> dirty = false;
   node -> left = NULL;
   node -> right = NULL;
+  node -> arena = NULL;
   return node;
 }
 
@@ -278,6 +345,7 @@ void printTreeInorder_(closest_AVL_Node * node, int offset) {
 }
 
 void printTreeInorder(closest_AVL_Node * node) {
+  refreshTree(node);
   printTreeInorder_(node, 0);
 }
 
@@ -441,19 +509,800 @@ closest_AVL_Node * delete(closest_AVL_Node * node, int key) {
   return result;
 }
 
+/*************************************************************************
+ ** Bulk construction
+ *************************************************************************/
+
+closest_AVL_Node * buildTreeFromSorted(int keys[], void * values[], int size) {
+  if (size <= 0) {
+    return NULL;
+  }
+
+  // The middle key becomes the root, so the two halves differ in size by
+  // at most one and the result is balanced without any rotations.
+  int mid = size / 2;
+  closest_AVL_Node * node = createNode(keys[mid],
+    values == NULL ? NULL : values[mid]);
+  node -> left = buildTreeFromSorted(keys, values, mid);
+  node -> right = buildTreeFromSorted(keys + mid + 1,
+    values == NULL ? NULL : values + mid + 1, size - mid - 1);
+
+  updateAll(node);
+  return node;
+}
+
+/*************************************************************************
+ ** Fingers
+ *************************************************************************/
+
+void resetFinger(closest_AVL_Finger * finger, closest_AVL_Node * root) {
+  finger -> root = root;
+  finger -> depth = 0;
+  for (closest_AVL_Node * node = root; node != NULL; node = node -> right) {
+    finger -> path[finger -> depth++] = node;
+  }
+}
+
+closest_AVL_Node * appendKey(closest_AVL_Finger * finger, int key,
+  void * value) {
+  closest_AVL_Node * root = finger -> root;
+
+  // Out-of-order keys (and the empty tree) take the normal insertion path.
+  if (root == NULL || key <= getMax(root)) {
+    root = insert(root, key, value);
+    resetFinger(finger, root);
+    return root;
+  }
+
+  // The finger may have been moved elsewhere, e.g. by a finger search.
+  if (finger -> depth == 0 || finger -> path[0] != root ||
+    finger -> path[finger -> depth - 1] -> right != NULL ||
+    finger -> path[finger -> depth - 1] -> key != getMax(root)) {
+    resetFinger(finger, root);
+  }
+
+  // Hang the new node off the current max.
+  closest_AVL_Node * last = finger -> path[finger -> depth - 1];
+  last -> right = createNode(key, value);
+  finger -> path[finger -> depth++] = last -> right;
+  int gap = key - last -> key;
+
+  // Walk back up the spine. Every spine node gets the new max; the closest
+  // pair only changes while the new gap beats the pair already stored, and
+  // pairs can only get closer going up, so we stop checking once it fails.
+  bool pairChanging = true;
+  for (int i = finger -> depth - 2; i >= 0; i--) {
+    closest_AVL_Node * v = finger -> path[i];
+    updateHeight(v);
+    v -> max = key;
+    if (lazyAugmentation) {
+      v -> dirty = true;
+    } else if (pairChanging) {
+      if (v -> closest_pair == NULL) {
+        updateClosestPair(v);
+      } else if (gap < v -> closest_pair -> upper - v -> closest_pair -> lower) {
+        v -> closest_pair -> lower = last -> key;
+        v -> closest_pair -> upper = key;
+      } else {
+        pairChanging = false;
+      }
+    }
+
+    // Appending on the right can only make a node right-right heavy, which
+    // a single left rotation fixes; its right child then takes its place
+    // on the spine.
+    if (balanceFactor(v) < -1) {
+      closest_AVL_Node * x = leftRotation(v);
+      if (i == 0) {
+        root = x;
+      } else {
+        finger -> path[i - 1] -> right = x;
+      }
+      for (int j = i; j < finger -> depth - 1; j++) {
+        finger -> path[j] = finger -> path[j + 1];
+      }
+      finger -> depth--;
+    }
+  }
+
+  finger -> root = root;
+  return root;
+}
+
+closest_AVL_Node * fingerSearch(closest_AVL_Finger * finger, int key) {
+  if (finger -> root == NULL) {
+    return NULL;
+  }
+  if (finger -> depth == 0 || finger -> path[0] != finger -> root) {
+    finger -> path[0] = finger -> root;
+    finger -> depth = 1;
+  }
+
+  // Climb to the lowest saved ancestor whose subtree can contain 'key'.
+  int i = finger -> depth - 1;
+  while (i > 0 && (key < getMin(finger -> path[i]) ||
+    key > getMax(finger -> path[i]))) {
+    i--;
+  }
+  finger -> depth = i + 1;
+
+  // Ordinary descent from there, extending the saved path as we go.
+  closest_AVL_Node * node = finger -> path[i];
+  while (node -> key != key) {
+    closest_AVL_Node * next = (key < node -> key) ? node -> left : node -> right;
+    if (next == NULL) {
+      return NULL;
+    }
+    node = next;
+    finger -> path[finger -> depth++] = node;
+  }
+  return node;
+}
+
+/*************************************************************************
+ ** Set operations
+ *************************************************************************/
+
+/*
+ * Returns the root of the tree holding the keys of 'left', the node
+ * 'middle' and the keys of 'right', where every key of 'left' is smaller
+ * than middle's key and every key of 'right' is larger. Walks down the
+ * spine of the taller tree until the heights match, so it runs in
+ * O(|height(left) - height(right)| + 1).
+ */
+closest_AVL_Node * joinTrees(closest_AVL_Node * left, closest_AVL_Node * middle,
+  closest_AVL_Node * right) {
+  if (height(left) > height(right) + 1) {
+    left -> right = joinTrees(left -> right, middle, right);
+    updateAll(left);
+    return rebalance(left);
+  }
+  if (height(right) > height(left) + 1) {
+    right -> left = joinTrees(left, middle, right -> left);
+    updateAll(right);
+    return rebalance(right);
+  }
+  middle -> left = left;
+  middle -> right = right;
+  updateAll(middle);
+  return middle;
+}
+
+/*
+ * Splits the tree rooted at 'node' into the keys smaller than 'key'
+ * (stored in 'left') and the keys larger than 'key' (stored in 'right').
+ * Returns the node holding 'key', detached from both, or NULL if there is
+ * none. O(log n).
+ */
+closest_AVL_Node * splitTree(closest_AVL_Node * node, int key,
+  closest_AVL_Node ** left, closest_AVL_Node ** right) {
+  if (node == NULL) {
+    * left = NULL;
+    * right = NULL;
+    return NULL;
+  }
+
+  closest_AVL_Node * l = node -> left;
+  closest_AVL_Node * r = node -> right;
+  closest_AVL_Node * found;
+  if (key < node -> key) {
+    found = splitTree(l, key, left, & l);
+    * right = joinTrees(l, node, r);
+  } else if (key > node -> key) {
+    found = splitTree(r, key, & r, right);
+    * left = joinTrees(l, node, r);
+  } else {
+    * left = l;
+    * right = r;
+    node -> left = NULL;
+    node -> right = NULL;
+    updateAll(node);
+    found = node;
+  }
+  return found;
+}
+
+/*
+ * Removes the max node from the tree rooted at 'node', storing the rest of
+ * the tree in 'rest', and returns the removed node. O(log n).
+ */
+closest_AVL_Node * splitLast(closest_AVL_Node * node, closest_AVL_Node ** rest) {
+  if (node -> right == NULL) {
+    * rest = node -> left;
+    node -> left = NULL;
+    updateAll(node);
+    return node;
+  }
+  closest_AVL_Node * right;
+  closest_AVL_Node * last = splitLast(node -> right, & right);
+  * rest = joinTrees(node -> left, node, right);
+  return last;
+}
+
+// Same as joinTrees, without a middle node.
+closest_AVL_Node * joinTrees2(closest_AVL_Node * left, closest_AVL_Node * right) {
+  if (left == NULL) {
+    return right;
+  }
+  closest_AVL_Node * rest;
+  closest_AVL_Node * last = splitLast(left, & rest);
+  return joinTrees(rest, last, right);
+}
+
+typedef closest_AVL_Node * (* SetOperation)(closest_AVL_Node * a,
+  closest_AVL_Node * b, int depth);
+
+typedef struct set_operation_task {
+  SetOperation operation;
+  closest_AVL_Node * a;
+  closest_AVL_Node * b;
+  int depth;
+  closest_AVL_Node * result;
+} SetOperationTask;
+
+void * runSetOperationTask(void * arg) {
+  SetOperationTask * task = arg;
+  task -> result = task -> operation(task -> a, task -> b, task -> depth);
+  return NULL;
+}
+
+/*
+ * Computes operation(a1, b1) into 'r1' and operation(a2, b2) into 'r2'.
+ * The two calls touch disjoint nodes, so the first one is forked onto its
+ * own thread when we are still shallow enough and the work is big enough.
+ */
+void setOperationBoth(SetOperation operation, int depth,
+  closest_AVL_Node * a1, closest_AVL_Node * b1, closest_AVL_Node ** r1,
+  closest_AVL_Node * a2, closest_AVL_Node * b2, closest_AVL_Node ** r2) {
+  SetOperationTask task = {operation, a1, b1, depth + 1, NULL};
+  pthread_t thread;
+  if (depth < setOperationForkDepth &&
+    height(a1) + height(b1) >= SET_OPERATION_FORK_HEIGHT &&
+    pthread_create( & thread, NULL, runSetOperationTask, & task) == 0) {
+    * r2 = operation(a2, b2, depth + 1);
+    pthread_join(thread, NULL);
+  } else {
+    runSetOperationTask( & task);
+    * r2 = operation(a2, b2, depth + 1);
+  }
+  * r1 = task.result;
+}
+
+closest_AVL_Node * unionTrees_(closest_AVL_Node * a, closest_AVL_Node * b,
+  int depth) {
+  if (a == NULL) {
+    return b;
+  }
+  if (b == NULL) {
+    return a;
+  }
+
+  // Split 'b' around the root of 'a', then merge the halves recursively.
+  closest_AVL_Node * aLeft = a -> left;
+  closest_AVL_Node * aRight = a -> right;
+  closest_AVL_Node * bLeft;
+  closest_AVL_Node * bRight;
+  closest_AVL_Node * duplicate = splitTree(b, a -> key, & bLeft, & bRight);
+  if (duplicate != NULL) {
+    deleteNode(duplicate);
+  }
+
+  closest_AVL_Node * left;
+  closest_AVL_Node * right;
+  setOperationBoth(unionTrees_, depth, aLeft, bLeft, & left,
+    aRight, bRight, & right);
+  return joinTrees(left, a, right);
+}
+
+closest_AVL_Node * intersectTrees_(closest_AVL_Node * a, closest_AVL_Node * b,
+  int depth) {
+  if (a == NULL || b == NULL) {
+    deleteTree(a);
+    deleteTree(b);
+    return NULL;
+  }
+
+  closest_AVL_Node * aLeft = a -> left;
+  closest_AVL_Node * aRight = a -> right;
+  closest_AVL_Node * bLeft;
+  closest_AVL_Node * bRight;
+  closest_AVL_Node * duplicate = splitTree(b, a -> key, & bLeft, & bRight);
+
+  closest_AVL_Node * left;
+  closest_AVL_Node * right;
+  setOperationBoth(intersectTrees_, depth, aLeft, bLeft, & left,
+    aRight, bRight, & right);
+
+  // a's root survives only if 'b' had the same key.
+  if (duplicate != NULL) {
+    deleteNode(duplicate);
+    return joinTrees(left, a, right);
+  }
+  deleteNode(a);
+  return joinTrees2(left, right);
+}
+
+closest_AVL_Node * differenceTrees_(closest_AVL_Node * a, closest_AVL_Node * b,
+  int depth) {
+  if (a == NULL || b == NULL) {
+    deleteTree(b);
+    return a;
+  }
+
+  closest_AVL_Node * aLeft = a -> left;
+  closest_AVL_Node * aRight = a -> right;
+  closest_AVL_Node * bLeft;
+  closest_AVL_Node * bRight;
+  closest_AVL_Node * duplicate = splitTree(b, a -> key, & bLeft, & bRight);
+
+  closest_AVL_Node * left;
+  closest_AVL_Node * right;
+  setOperationBoth(differenceTrees_, depth, aLeft, bLeft, & left,
+    aRight, bRight, & right);
+
+  // a's root survives only if 'b' did not have the same key.
+  if (duplicate != NULL) {
+    deleteNode(duplicate);
+    deleteNode(a);
+    return joinTrees2(left, right);
+  }
+  return joinTrees(left, a, right);
+}
+
+closest_AVL_Node * unionTrees(closest_AVL_Node * a, closest_AVL_Node * b) {
+  return unionTrees_(a, b, 0);
+}
+
+closest_AVL_Node * intersectTrees(closest_AVL_Node * a, closest_AVL_Node * b) {
+  return intersectTrees_(a, b, 0);
+}
+
+closest_AVL_Node * differenceTrees(closest_AVL_Node * a, closest_AVL_Node * b) {
+  return differenceTrees_(a, b, 0);
+}
+
+void setSetOperationThreads(int threads) {
+  // Each level of forking doubles the number of running threads.
+  setOperationForkDepth = 0;
+  while ((1 << setOperationForkDepth) < threads) {
+    setOperationForkDepth++;
+  }
+}
+
+/*************************************************************************
+ ** Closest pair between two trees
+ *************************************************************************/
+
+closest_AVL_Node * floorNode(closest_AVL_Node * node, int key) {
+  closest_AVL_Node * result = NULL;
+  while (node != NULL) {
+    if (node -> key == key) {
+      return node;
+    } else if (node -> key < key) {
+      result = node;
+      node = node -> right;
+    } else {
+      node = node -> left;
+    }
+  }
+  return result;
+}
+
+closest_AVL_Node * ceilingNode(closest_AVL_Node * node, int key) {
+  closest_AVL_Node * result = NULL;
+  while (node != NULL) {
+    if (node -> key == key) {
+      return node;
+    } else if (node -> key > key) {
+      result = node;
+      node = node -> left;
+    } else {
+      node = node -> right;
+    }
+  }
+  return result;
+}
+
+typedef struct cross_search {
+  closest_AVL_Node * other;  // the tree we look up nearest keys in
+  bool found;
+  long long gap;             // |mine - theirs| of the best pair so far
+  int mine;                  // best key from the tree being walked
+  int theirs;                // best key from 'other'
+} CrossSearch;
+
+// Compares 'key' with its nearest keys in the other tree.
+void crossSearchKey(CrossSearch * search, int key) {
+  closest_AVL_Node * below = floorNode(search -> other, key);
+  closest_AVL_Node * above = ceilingNode(search -> other, key);
+  if (below != NULL && (!search -> found ||
+      (long long) key - below -> key < search -> gap)) {
+    search -> found = true;
+    search -> gap = (long long) key - below -> key;
+    search -> mine = key;
+    search -> theirs = below -> key;
+  }
+  if (above != NULL && (!search -> found ||
+      (long long) above -> key - key < search -> gap)) {
+    search -> found = true;
+    search -> gap = (long long) above -> key - key;
+    search -> mine = key;
+    search -> theirs = above -> key;
+  }
+}
+
+void crossSearchTree(CrossSearch * search, closest_AVL_Node * node) {
+  if (node == NULL || (search -> found && search -> gap == 0)) {
+    return;
+  }
+
+  // If no key of the other tree falls inside this subtree's range, every
+  // pair through this subtree is at least as far as the range's
+  // distance to the other tree's nearest keys outside it.
+  if (search -> found) {
+    closest_AVL_Node * above = ceilingNode(search -> other, node -> min);
+    if (above == NULL || above -> key > node -> max) {
+      closest_AVL_Node * below = floorNode(search -> other, node -> min);
+      long long bound = LLONG_MAX;
+      if (above != NULL) {
+        bound = (long long) above -> key - node -> max;
+      }
+      if (below != NULL && (long long) node -> min - below -> key < bound) {
+        bound = (long long) node -> min - below -> key;
+      }
+      if (bound >= search -> gap) {
+        return;
+      }
+    }
+  }
+
+  crossSearchKey(search, node -> key);
+  crossSearchTree(search, node -> left);
+  crossSearchTree(search, node -> right);
+}
+
+bool closestCrossPair(closest_AVL_Node * a, closest_AVL_Node * b, int * keyA,
+  int * keyB) {
+  if (a == NULL || b == NULL) {
+    return false;
+  }
+
+  // Walk the smaller tree (by height) and probe the larger one.
+  bool walkA = height(a) <= height(b);
+  CrossSearch search = {walkA ? b : a, false, 0, 0, 0};
+  crossSearchTree( & search, walkA ? a : b);
+  * keyA = walkA ? search.mine : search.theirs;
+  * keyB = walkA ? search.theirs : search.mine;
+  return true;
+}
+
+void initCrossPair(closest_AVL_CrossPair * cross, closest_AVL_Node * a,
+  closest_AVL_Node * b) {
+  cross -> trees[0] = a;
+  cross -> trees[1] = b;
+  cross -> found = false;
+  cross -> stale = true;
+}
+
+void crossPairInsert(closest_AVL_CrossPair * cross, int side, int key,
+  void * value) {
+  cross -> trees[side] = insert(cross -> trees[side], key, value);
+  if (cross -> stale) {
+    return;
+  }
+
+  // Only the new key can form a closer pair than the current one.
+  CrossSearch search = {cross -> trees[1 - side], false, 0, 0, 0};
+  crossSearchKey( & search, key);
+  if (search.found && (!cross -> found || search.gap <
+      llabs((long long) cross -> keys[0] - cross -> keys[1]))) {
+    cross -> found = true;
+    cross -> keys[side] = key;
+    cross -> keys[1 - side] = search.theirs;
+  }
+}
+
+void crossPairDelete(closest_AVL_CrossPair * cross, int side, int key) {
+  cross -> trees[side] = delete(cross -> trees[side], key);
+  if (cross -> found && cross -> keys[side] == key) {
+    cross -> stale = true;
+  }
+}
+
+bool getCrossPair(closest_AVL_CrossPair * cross, int * keyA, int * keyB) {
+  if (cross -> stale) {
+    cross -> found = closestCrossPair(cross -> trees[0], cross -> trees[1],
+      & cross -> keys[0], & cross -> keys[1]);
+    cross -> stale = false;
+  }
+  if (cross -> found) {
+    * keyA = cross -> keys[0];
+    * keyB = cross -> keys[1];
+  }
+  return cross -> found;
+}
+
+/*************************************************************************
+ ** Splay mode
+ *************************************************************************/
+
+// Rotates 'child' above its parent 'parent'; returns 'child'.
+closest_AVL_Node * rotateUp(closest_AVL_Node * parent, closest_AVL_Node * child) {
+  if (parent -> left == child) {
+    return rightRotation(parent);
+  }
+  return leftRotation(parent);
+}
+
+// Makes 'newChild' the child of 'parent' where 'oldChild' used to be.
+void replaceChild(closest_AVL_Node * parent, closest_AVL_Node * oldChild,
+  closest_AVL_Node * newChild) {
+  if (parent -> left == oldChild) {
+    parent -> left = newChild;
+  } else {
+    parent -> right = newChild;
+  }
+}
+
+/*
+ * Splays the node with key 'key', or the last node on its search path, to
+ * the root of the tree rooted at 'root', and returns the new root. The
+ * node splayed is stored in 'last'. Bottom-up, along a recorded path, since
+ * a splay tree can be too deep to recurse on.
+ */
+closest_AVL_Node * splay(closest_AVL_Node * root, int key,
+  closest_AVL_Node ** last) {
+  * last = NULL;
+  if (root == NULL) {
+    return NULL;
+  }
+
+  closest_AVL_Node * stackPath[MAX_AVL_HEIGHT];
+  closest_AVL_Node ** path = stackPath;
+  int capacity = MAX_AVL_HEIGHT;
+  int depth = 0;
+  closest_AVL_Node * node = root;
+  while (node != NULL) {
+    if (depth == capacity) {
+      capacity *= 2;
+      if (path == stackPath) {
+        path = malloc(sizeof(closest_AVL_Node * ) * capacity);
+        memcpy(path, stackPath, sizeof(stackPath));
+      } else {
+        path = realloc(path, sizeof(closest_AVL_Node * ) * capacity);
+      }
+    }
+    path[depth++] = node;
+    if (node -> key == key) {
+      break;
+    }
+    node = (key < node -> key) ? node -> left : node -> right;
+  }
+
+  * last = path[depth - 1];
+
+  // Each step lifts x by two levels (zig-zig or zig-zag), or by one level
+  // when its parent is the root (zig). Rotations update the nodes they
+  // move, bottom-up, so the augmentation is right once x is at the top.
+  int i = depth - 1;
+  closest_AVL_Node * x = path[i];
+  while (i > 0) {
+    closest_AVL_Node * p = path[i - 1];
+    int top;
+    if (i == 1) {
+      rotateUp(p, x);
+      top = 0;
+    } else {
+      closest_AVL_Node * g = path[i - 2];
+      if ((g -> left == p) == (p -> left == x)) {
+        rotateUp(g, p);
+        rotateUp(p, x);
+      } else {
+        replaceChild(g, p, rotateUp(p, x));
+        rotateUp(g, x);
+      }
+      top = i - 2;
+    }
+    if (top > 0) {
+      replaceChild(path[top - 1], path[top], x);
+    }
+    path[top] = x;
+    i = top;
+  }
+
+  if (path != stackPath) {
+    free(path);
+  }
+  return x;
+}
+
+closest_AVL_Node * splaySearch(closest_AVL_Node ** root, int key) {
+  closest_AVL_Node * last;
+  * root = splay( * root, key, & last);
+  return (last != NULL && last -> key == key) ? last : NULL;
+}
+
+closest_AVL_Node * splayInsert(closest_AVL_Node * root, int key, void * value) {
+  closest_AVL_Node * last;
+  root = splay(root, key, & last);
+  if (root != NULL && root -> key == key) {
+    root -> value = value;
+    return root;
+  }
+
+  // The old root is the new key's predecessor or successor, so the new
+  // node can take over the root with the old one as a child.
+  closest_AVL_Node * node = createNode(key, value);
+  if (root == NULL) {
+    return node;
+  }
+  if (key < root -> key) {
+    node -> left = root -> left;
+    node -> right = root;
+    root -> left = NULL;
+  } else {
+    node -> right = root -> right;
+    node -> left = root;
+    root -> right = NULL;
+  }
+  updateAll(root);
+  updateAll(node);
+  return node;
+}
+
+closest_AVL_Node * splayDelete(closest_AVL_Node * root, int key) {
+  closest_AVL_Node * last;
+  root = splay(root, key, & last);
+  if (root == NULL || root -> key != key) {
+    return root;
+  }
+
+  closest_AVL_Node * left = root -> left;
+  closest_AVL_Node * right = root -> right;
+  deleteNode(root);
+  if (left == NULL) {
+    return right;
+  }
+
+  // Every key on the left is smaller than 'key', so splaying for it brings
+  // the max of the left side up, with no right child.
+  left = splay(left, key, & last);
+  left -> right = right;
+  updateAll(left);
+  return left;
+}
+
+/*************************************************************************
+ ** Relayout
+ *************************************************************************/
+
+void startRelayout(closest_AVL_Relayout * relayout, closest_AVL_Node * root) {
+  relayout -> root = root;
+  relayout -> capacity = 1024;
+  relayout -> old = malloc(sizeof(closest_AVL_Node * ) * relayout -> capacity);
+  relayout -> size = 0;
+  if (root != NULL) {
+    relayout -> old[relayout -> size++] = root;
+  }
+  relayout -> scanned = 0;
+  relayout -> arena = NULL;
+  relayout -> nodes = NULL;
+  relayout -> pairs = NULL;
+  relayout -> copied = 0;
+  relayout -> linked = 1;
+  relayout -> freed = 0;
+  relayout -> done = false;
+}
+
+closest_AVL_Node * relayoutStep(closest_AVL_Relayout * relayout, long budget) {
+  long work = 0;
+  if (relayout -> done) {
+    return relayout -> root;
+  }
+
+  // 1. List the old nodes in BFS order; the list doubles as the queue.
+  while (relayout -> scanned < relayout -> size && work++ < budget) {
+    closest_AVL_Node * node = relayout -> old[relayout -> scanned++];
+    if (relayout -> size + 2 > relayout -> capacity) {
+      relayout -> capacity *= 2;
+      relayout -> old = realloc(relayout -> old,
+        sizeof(closest_AVL_Node * ) * relayout -> capacity);
+    }
+    if (node -> left != NULL) {
+      relayout -> old[relayout -> size++] = node -> left;
+    }
+    if (node -> right != NULL) {
+      relayout -> old[relayout -> size++] = node -> right;
+    }
+  }
+  if (relayout -> scanned < relayout -> size) {
+    return relayout -> root;
+  }
+
+  // 2. Copy them, in the same order, into one block: the arena header,
+  // the nodes (aligned to cache lines, which they fill exactly on LP64),
+  // then their pairs.
+  long size = relayout -> size;
+  if (relayout -> arena == NULL && size > 0) {
+    size_t nodeBytes = sizeof(closest_AVL_Node) * size;
+    size_t bytes = RELAYOUT_ARENA_HEADER + nodeBytes + sizeof(pair) * size;
+    bytes = (bytes + 63) / 64 * 64;
+    char * block = aligned_alloc(64, bytes);
+    RelayoutArena * arena = (RelayoutArena * ) block;
+    atomic_init( & arena -> live, size);
+    arena -> pairs = (pair * )(block + RELAYOUT_ARENA_HEADER + nodeBytes);
+    arena -> size = size;
+    relayout -> arena = arena;
+    relayout -> nodes = (closest_AVL_Node * )(block + RELAYOUT_ARENA_HEADER);
+    relayout -> pairs = arena -> pairs;
+  }
+  while (relayout -> copied < size && work++ < budget) {
+    long i = relayout -> copied++;
+    closest_AVL_Node * node = & relayout -> nodes[i];
+    * node = * relayout -> old[i];
+    node -> arena = relayout -> arena;
+    // Children were queued in this same order, so they get the next slots.
+    if (node -> left != NULL) {
+      node -> left = & relayout -> nodes[relayout -> linked++];
+    }
+    if (node -> right != NULL) {
+      node -> right = & relayout -> nodes[relayout -> linked++];
+    }
+    if (node -> closest_pair != NULL) {
+      relayout -> pairs[i] = * node -> closest_pair;
+      node -> closest_pair = & relayout -> pairs[i];
+    }
+  }
+  if (relayout -> copied < size) {
+    return relayout -> root;
+  }
+
+  // 3. Switch to the copy and free the old nodes.
+  relayout -> root = (size > 0) ? & relayout -> nodes[0] : NULL;
+  while (relayout -> freed < size && work++ < budget) {
+    deleteNode(relayout -> old[relayout -> freed++]);
+  }
+  if (relayout -> freed == size) {
+    free(relayout -> old);
+    relayout -> old = NULL;
+    relayout -> done = true;
+  }
+  return relayout -> root;
+}
+
+closest_AVL_Node * relayout(closest_AVL_Node * root) {
+  closest_AVL_Relayout state;
+  startRelayout( & state, root);
+  return relayoutStep( & state, LONG_MAX);
+}
+
 /*************************************************************************
  ** Required functions
- ** Must run in O(1)
+ ** Must run in O(1) (O(k) for k dirty nodes under lazy augmentation)
  *************************************************************************/
 
 pair * getClosestPair(closest_AVL_Node * node) {
+  if (node == NULL) {
+    return NULL;
+  }
+  refreshTree(node);
   return node -> closest_pair;
 }
 
-void deleteNode(closest_AVL_Node * node) {
-  if (node -> closest_pair != NULL) {
-    free(node -> closest_pair);
+void setLazyAugmentation(bool enabled) {
+  lazyAugmentation = enabled;
+}
+
+void refreshTree(closest_AVL_Node * node) {
+  // A clean node never has dirty descendants, so we can stop here.
+  if (node == NULL || !node -> dirty) {
+    return;
   }
-  free(node);
+  updateClosestPair(node);
+}
+
+void deleteNode(closest_AVL_Node * node) {
+  freePair(node);
+  freeNode(node);
   return;
 }
\ No newline at end of file
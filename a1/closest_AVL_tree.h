@@ -0,0 +1,296 @@
+/*
+ *  Header file for our closest-AVL (augmented with closest-pair AVL)
+ *  tree implementation.
+ *
+ *  Author: Akshay Arun Bapat.
+ *  Based on materials developed by Anya Tafliovich and F. Estrada.
+ *
+ *  Extends the starter version of this header, which is kept unchanged in
+ *  starter/.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdbool.h>
+
+#ifndef __closest_AVL_tree_header
+#define __closest_AVL_tree_header
+
+typedef struct pair
+{
+  int lower;            // lower value of the pair
+  int upper;            // upper value of the pair
+} pair;
+
+typedef struct closest_AVL_node
+{
+  int key;                  // key stored in this node
+  int height;               // height of tree rooted at this node
+  int min;                  // min value in tree rooted at this node
+  int max;                  // max value in tree rooted at this node
+  void* value;              // value associated with this node's key
+  struct pair* closest_pair; // closest-pair in tree rooted at this node
+  struct closest_AVL_node* left;   // this node's left child
+  struct closest_AVL_node* right;  // this node's right child
+  struct closest_AVL_arena* arena; // relayout arena holding this node, or
+                                   // NULL if it was allocated on its own
+  bool dirty;               // closest_pair is stale (lazy augmentation only)
+} closest_AVL_Node;
+
+// An AVL tree of n nodes is at most 1.44 log2(n + 2) high, so 64 levels
+// is more than enough for any tree keyed by int.
+#define MAX_AVL_HEIGHT 64
+
+/*
+ * A finger remembers the path from the root to one node of a closest-AVL
+ * tree, so that operations near that node do not have to start at the
+ * root. A finger is only valid as long as the tree is changed through it;
+ * after any other 'insert' or 'delete', call 'resetFinger' again.
+ */
+typedef struct closest_AVL_finger
+{
+  closest_AVL_Node* root;                  // root of the tracked tree
+  closest_AVL_Node* path[MAX_AVL_HEIGHT];  // path[0] is root, last is finger
+  int depth;                               // number of nodes on 'path'
+} closest_AVL_Finger;
+
+/*
+ * Keeps the closest pair between two trees (one key from each) up to date
+ * while keys are inserted into and deleted from either tree through it.
+ */
+typedef struct closest_AVL_cross_pair
+{
+  closest_AVL_Node* trees[2];  // the two trees, 'a' and 'b'
+  int keys[2];                 // keys[0] from 'a', keys[1] from 'b'
+  bool found;                  // false if either tree is empty
+  bool stale;                  // a key of the pair was deleted; recompute
+} closest_AVL_CrossPair;
+
+/*
+ * State of an incremental relayout (see 'startRelayout').
+ */
+typedef struct closest_AVL_relayout
+{
+  closest_AVL_Node* root;      // root to use between steps
+  closest_AVL_Node** old;      // nodes of the old tree in BFS order
+  long size;                   // number of nodes in 'old' so far
+  long capacity;               // room in 'old'
+  long scanned;                // nodes of 'old' whose children were queued
+  struct closest_AVL_arena* arena; // new arena, NULL until allocated
+  closest_AVL_Node* nodes;     // nodes of 'arena', nodes[i] copies old[i]
+  pair* pairs;                 // closest pairs of 'nodes', same order
+  long copied;                 // nodes copied into the arena
+  long linked;                 // next arena slot to become a child
+  long freed;                  // old nodes freed after the switch
+  bool done;                   // finished; 'root' is in the new arena
+} closest_AVL_Relayout;
+
+/*
+ * Returns the node, from the tree rooted at 'node', that contains key 'key'.
+ * Returns NULL if 'key' is not in the tree.
+ */
+closest_AVL_Node* search(closest_AVL_Node* node, int key);
+
+/*
+ * Inserts the key/value pair 'key'/'value' into the closest-AVL tree rooted
+ * at 'node'.  If 'key' is already a key in the tree, updates the value
+ * associated with 'key' to 'value'. Returns the root of the resulting tree.
+ */
+closest_AVL_Node* insert(closest_AVL_Node* node, int key, void* value);
+
+/*
+ * Deletes the node with key 'key' from the closest-AVL tree rooted at 'node'.
+ * If 'key' is not a key in the tree, the tree is unchanged.
+ * Returns the root of the resulting tree.
+ */
+closest_AVL_Node* delete(closest_AVL_Node* node, int key);
+
+/*
+ * Builds and returns a perfectly balanced closest-AVL tree holding the 'size'
+ * keys in 'keys', which must be sorted in strictly increasing order. Key
+ * keys[i] gets value values[i], or NULL if 'values' is NULL. Runs in O(size).
+ */
+closest_AVL_Node* buildTreeFromSorted(int keys[], void* values[], int size);
+
+/*
+ * Points 'finger' at the max key of the tree rooted at 'root', i.e. at the
+ * end of its right spine. O(log n).
+ */
+void resetFinger(closest_AVL_Finger* finger, closest_AVL_Node* root);
+
+/*
+ * Inserts 'key'/'value' into the tree tracked by 'finger' and returns the
+ * new root. If 'key' is larger than every key in the tree, it is appended
+ * at the end of the right spine using at most one rotation, and only the
+ * spine's min/max/closest pair are touched, stopping the closest-pair
+ * updates as soon as the new gap no longer improves on them. Otherwise
+ * falls back to 'insert'. The finger is left at the new max key.
+ */
+closest_AVL_Node* appendKey(closest_AVL_Finger* finger, int key, void* value);
+
+/*
+ * Returns the node with key 'key' in the tree tracked by 'finger', or NULL
+ * if there is none, and moves the finger to the last node visited. The
+ * search climbs the saved path only until it reaches a subtree whose
+ * [min, max] covers 'key', then descends from there. For a target d keys
+ * away this is usually O(log d); a sweep in key order costs O(1) amortized
+ * per step.
+ */
+closest_AVL_Node* fingerSearch(closest_AVL_Finger* finger, int key);
+
+/*
+ * Set operations on two closest-AVL trees, based on split and join. Each
+ * returns the root of the result. Both input trees are consumed: their
+ * nodes are reused for the result or freed. Where a key is in both trees,
+ * the node (and value) from 'a' is kept.
+ *
+ * For trees of sizes m <= n, the splits and joins take O(m log(n/m + 1)).
+ * That is the whole cost of unionTrees, which only frees the (at most m)
+ * duplicate nodes. intersectTrees and differenceTrees also free every
+ * node that is not in the result, adding O(k) for k freed nodes: e.g.
+ * intersecting a small tree with a large one frees almost all of the
+ * large one, so it costs O(n).
+ *
+ *   unionTrees:        keys in 'a' or 'b'
+ *   intersectTrees:    keys in both 'a' and 'b'
+ *   differenceTrees:   keys in 'a' but not in 'b'
+ */
+closest_AVL_Node* unionTrees(closest_AVL_Node* a, closest_AVL_Node* b);
+closest_AVL_Node* intersectTrees(closest_AVL_Node* a, closest_AVL_Node* b);
+closest_AVL_Node* differenceTrees(closest_AVL_Node* a, closest_AVL_Node* b);
+
+/*
+ * Lets the set operations above run their two recursive halves in parallel
+ * (fork-join) using up to 'threads' threads. 1, the default, is serial.
+ */
+void setSetOperationThreads(int threads);
+
+/*
+ * Returns the node with the largest key <= 'key' (floorNode) or the smallest
+ * key >= 'key' (ceilingNode) in the tree rooted at 'node', or NULL if there
+ * is none. O(log n).
+ */
+closest_AVL_Node* floorNode(closest_AVL_Node* node, int key);
+closest_AVL_Node* ceilingNode(closest_AVL_Node* node, int key);
+
+/*
+ * Finds the closest pair between two trees: the keys 'keyA' in 'a' and
+ * 'keyB' in 'b' minimizing |keyA - keyB|. Returns false if either tree is
+ * empty. Walks the smaller tree, looking up its nearest keys in the larger
+ * one and skipping every subtree whose [min, max] range is already farther
+ * from the larger tree than the best pair so far. O(m log n) at worst for
+ * trees of sizes m <= n, usually much less.
+ */
+bool closestCrossPair(closest_AVL_Node* a, closest_AVL_Node* b, int* keyA,
+    int* keyB);
+
+/*
+ * Starts tracking the closest pair between trees 'a' and 'b' in 'cross'.
+ */
+void initCrossPair(closest_AVL_CrossPair* cross, closest_AVL_Node* a,
+    closest_AVL_Node* b);
+
+/*
+ * Inserts 'key'/'value' into tree 'side' (0 for 'a', 1 for 'b') of 'cross',
+ * comparing it with its nearest keys in the other tree. O(log n).
+ */
+void crossPairInsert(closest_AVL_CrossPair* cross, int side, int key,
+    void* value);
+
+/*
+ * Deletes 'key' from tree 'side' (0 for 'a', 1 for 'b') of 'cross'. If
+ * 'key' was part of the closest pair, it is recomputed on the next query.
+ */
+void crossPairDelete(closest_AVL_CrossPair* cross, int side, int key);
+
+/*
+ * Stores the current closest pair between the trees of 'cross' in 'keyA'
+ * and 'keyB'. Returns false, leaving them unchanged, if either tree is
+ * empty.
+ */
+bool getCrossPair(closest_AVL_CrossPair* cross, int* keyA, int* keyB);
+
+/*
+ * Self-adjusting (splay) mode. These operations move the node they access
+ * to the root with splay-tree rotations, so frequently used keys stay near
+ * the top. Rotations recompute min/max/closest pair as usual, so the
+ * augmentation stays correct, but the tree is no longer height balanced:
+ * a tree used in splay mode should only be updated with splayInsert and
+ * splayDelete. All are O(log n) amortized.
+ *
+ *   splaySearch:  returns the node with key 'key' (NULL if none) and splays
+ *                 it (or the last node on its search path) to the root,
+ *                 storing the new root in 'root'.
+ *   splayInsert:  inserts 'key'/'value' (or updates the value) at the root
+ *                 and returns the new root.
+ *   splayDelete:  deletes 'key' if present and returns the new root.
+ */
+closest_AVL_Node* splaySearch(closest_AVL_Node** root, int key);
+closest_AVL_Node* splayInsert(closest_AVL_Node* root, int key, void* value);
+closest_AVL_Node* splayDelete(closest_AVL_Node* root, int key);
+
+/*
+ * Relayout. After long insert/delete churn a tree's nodes are scattered
+ * over the heap. A relayout copies them into one fresh contiguous arena in
+ * BFS order (each level stored together, so the top levels share a few
+ * pages and cache lines, as right after bulk loading) and frees the old
+ * nodes. It runs in bounded steps, so it can be spread between requests:
+ *
+ *   startRelayout:  begins relaying out the tree rooted at 'root'.
+ *   relayoutStep:   does at most about 'budget' nodes of work and returns
+ *                   the root to use until the next step. Once 'done' is
+ *                   set, that root is in the new arena and the old nodes
+ *                   are all freed.
+ *   relayout:       the whole thing at once; returns the new root.
+ *
+ * Queries may run between steps, but the tree must not be changed until
+ * the relayout is done. Afterwards it can be changed as usual: arena nodes
+ * are returned to their arena by deleteNode and the arena is released once
+ * all its nodes are gone.
+ */
+void startRelayout(closest_AVL_Relayout* relayout, closest_AVL_Node* root);
+closest_AVL_Node* relayoutStep(closest_AVL_Relayout* relayout, long budget);
+closest_AVL_Node* relayout(closest_AVL_Node* root);
+
+/*
+ * Returns the closest pair of keys within the tree rooted at 'node'.
+ * Returns NULL if the tree has less than 2 elements.
+ * Under lazy augmentation, dirty subtrees are recomputed first.
+ */
+pair* getClosestPair(closest_AVL_Node* node);
+
+/*
+ * Turns lazy augmentation on or off for all closest-AVL trees.
+ * While it is on, 'insert' and 'delete' only maintain height, min and max,
+ * and mark the closest pair of every node they touch as dirty. Dirty
+ * subtrees are recomputed by the next 'getClosestPair' (or 'refreshTree').
+ * Turning it off is always safe: eager updates refresh any dirty child
+ * they read. Lazy augmentation is off by default.
+ */
+void setLazyAugmentation(bool enabled);
+
+/*
+ * Recomputes the closest pair of every dirty node in the tree rooted at
+ * 'node'. Runs in O(k) where k is the number of dirty nodes; O(1) if the
+ * tree is clean.
+ */
+void refreshTree(closest_AVL_Node* node);
+
+/*
+ * Prints the keys of the closest-AVL tree rooted at 'node',
+ * in the in-order traversal order.
+ */
+void printTreeInorder(closest_AVL_Node* node);
+
+/*
+ * Frees the node 'node' of the closest-AVL tree.
+ */
+void deleteNode(closest_AVL_Node* node);
+
+/*
+ * Frees all memory allocated for a closest-AVL tree rooted at 'node'.
+ */
+void deleteTree(closest_AVL_Node* node);
+
+#endif
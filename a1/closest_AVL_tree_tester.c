@@ -0,0 +1,332 @@
+/*
+ *  Some light testing of our closest_AVL tree implementation.
+ *  Note that you will need to add your own, much more extensive,
+ *  testing to ensure correctness of your code.
+ *
+ *  Author: Akshay Arun Bapat.
+ *  Based on materials developed by Anya Tafliovich and F. Estrada.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "closest_AVL_tree.h"
+#include "compact_AVL_tree.h"
+
+#define MAX_LIMIT 1024
+
+closest_AVL_Node* createTree(FILE* f);
+void testTree(closest_AVL_Node* root);
+void printTreeReport(closest_AVL_Node* root);
+int bulkLoad(const char* path, bool compact);
+
+int main(int argc, char* argv[])
+{
+  closest_AVL_Node* root = NULL;
+
+  // "-b file" loads the file quietly and exits, for large smoke inputs;
+  // "-bc file" does the same into the compact node layout.
+  if (argc > 2 && strcmp(argv[1], "-b") == 0)
+  {
+    return bulkLoad(argv[2], false);
+  }
+  if (argc > 2 && strcmp(argv[1], "-bc") == 0)
+  {
+    return bulkLoad(argv[2], true);
+  }
+
+  // If user specified a file for reading, create a tree with keys from it.
+  if (argc > 1)
+  {
+    FILE* f = fopen(argv[1], "r");
+    if (f == NULL)
+    {
+      fprintf(stderr, "Unable to open the specified input file: %s\n", argv[1]);
+      exit(0);
+    }
+    root = createTree(f);
+    fclose(f);
+  }
+  else
+  {
+    printf("You did not specify an input file.");
+    printf(" We will start with an empty tree.\n");
+  }
+
+  testTree(root);
+  return 0;
+}
+
+closest_AVL_Node* createTree(FILE* f)
+{
+  char line[MAX_LIMIT];
+  int key = 0;
+  closest_AVL_Node* root = NULL;
+
+  while (fgets(line, MAX_LIMIT, f)) // read next line
+  {
+    key = atoi(line);
+    printf("read %d\n", key);
+    root = insert(root, key, NULL);  // no values for this simple tester
+    printTreeReport(root);
+  }
+  return root;
+}
+
+void testTree(closest_AVL_Node* root)
+{
+  char line[MAX_LIMIT];
+  closest_AVL_Node* node = NULL;
+
+  while (1)
+  {
+    printf("Choose a command:");
+    printf(" (s)earch, (i)nsert, (d)elete, (c)losest_pair, (q)uit\n");
+    fgets(line, MAX_LIMIT, stdin);
+    if (line[0] == 'q') // quit
+    {
+      printf("Quit selected. Goodbye!\n");
+      deleteTree(root);
+      return;
+    }
+    if (line[0] == 's') // search
+    {
+      printf("Search selected. Enter key to search for: ");
+      fgets(line, MAX_LIMIT, stdin);
+      node = search(root, atoi(line));
+      if (node != NULL)
+      {
+        printf("Key %d was found at height %d, subtree min/max (%d / %d).\n",
+            node->key, node->height, node->min, node->max);
+      }
+      else
+      {
+        printf("This key is not in the tree.\n");
+      }
+    }
+    else if (line[0] == 'i') // insert
+    {
+      printf("Insert selected. Enter key to insert");
+      printf(" (no values in this simple tester): ");
+      fgets(line, MAX_LIMIT, stdin);
+      root = insert(root, atoi(line), NULL);
+      printTreeReport(root);
+    }
+    else if (line[0] == 'd') // delete
+    {
+      printf("Delete selected. Enter key to delete: ");
+      fgets(line, MAX_LIMIT, stdin);
+      root = delete(root, atoi(line));
+      printTreeReport(root);
+    }
+    else if (line[0] == 'c') // closest_pair
+    {
+      printf("Get closest pair selected.");
+      pair* p = getClosestPair(root);
+      if (p != NULL)
+      {
+        printf("Closest pair found as (%d, %d).\n", p->lower, p->upper);
+      }
+      else
+      {
+        printf("Tree has less than 2 values");
+      }
+    }
+  }
+}
+
+void printTreeReport(closest_AVL_Node* root)
+{
+  printf("** The tree is now:\n");
+  printTreeInorder(root);
+  printf("**\n");
+}
+
+/*
+ * Parses one key per line from 'text' the way atoi does with each line
+ * read by createTree, storing them into 'keys'. Returns the number of keys.
+ */
+int scanKeys(const char* text, size_t length, int keys[])
+{
+  const char* p = text;
+  const char* end = text + length;
+  int count = 0;
+
+  while (p < end)
+  {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+      p++;
+    }
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      p++;
+    }
+    unsigned int value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+      value = value * 10 + (unsigned int)(*p - '0');
+      p++;
+    }
+    keys[count++] = negative ? (int)(0u - value) : (int)value;
+
+    // Skip whatever is left of the line, like atoi would.
+    const char* newline = memchr(p, '\n', end - p);
+    p = (newline == NULL) ? end : newline + 1;
+  }
+  return count;
+}
+
+int compareKeys(const void* a, const void* b)
+{
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+double secondsSince(struct timespec* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Non-interactive bulk mode: maps the file at 'path', parses its keys,
+ * sorts and de-duplicates them and builds the tree in one pass, then
+ * prints only timings and the final closest pair. With 'compact', the keys
+ * go into a compact_AVL_Arena instead and its footprint is reported too.
+ */
+int bulkLoad(const char* path, bool compact)
+{
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    fprintf(stderr, "Unable to open the specified input file: %s\n", path);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return 1;
+  }
+
+  int count = 0;
+  int* keys = NULL;
+  if (st.st_size > 0)
+  {
+    char* text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED)
+    {
+      fprintf(stderr, "Unable to map the specified input file: %s\n", path);
+      close(fd);
+      return 1;
+    }
+    madvise(text, st.st_size, MADV_SEQUENTIAL);
+
+    // scanKeys reads one key per line, so count the lines to size 'keys'.
+    size_t lines = 1;
+    for (const char* p = text; (p = memchr(p, '\n', text + st.st_size - p));
+         p++)
+    {
+      lines++;
+    }
+    keys = malloc(sizeof(int) * lines);
+    if (keys == NULL)
+    {
+      fprintf(stderr, "Not enough memory for the keys of: %s\n", path);
+      munmap(text, st.st_size);
+      close(fd);
+      return 1;
+    }
+    count = scanKeys(text, st.st_size, keys);
+    munmap(text, st.st_size);
+  }
+  close(fd);
+  double parseTime = secondsSince(&start);
+
+  // Inputs are often already sorted (e.g. timestamps); skip qsort then.
+  int sorted = 1;
+  for (int i = 1; i < count && sorted; i++)
+  {
+    sorted = keys[i - 1] <= keys[i];
+  }
+  if (!sorted)
+  {
+    qsort(keys, count, sizeof(int), compareKeys);
+  }
+  int distinct = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (distinct == 0 || keys[distinct - 1] != keys[i])
+    {
+      keys[distinct++] = keys[i];
+    }
+  }
+  double sortTime = secondsSince(&start) - parseTime;
+
+  closest_AVL_Node* root = NULL;
+  compact_AVL_Arena* arena = NULL;
+  uint32_t compactRoot = COMPACT_NIL;
+  pair closest;
+  bool found;
+  if (compact)
+  {
+    arena = newCompactArena(distinct);
+    for (int i = 0; i < distinct; i++)
+    {
+      compactRoot = compactInsert(arena, compactRoot, keys[i], NULL);
+    }
+    found = compactGetClosestPair(arena, compactRoot, &closest);
+  }
+  else
+  {
+    root = buildTreeFromSorted(keys, NULL, distinct);
+    pair* p = getClosestPair(root);
+    found = (p != NULL);
+    if (found)
+    {
+      closest = *p;
+    }
+  }
+  double buildTime = secondsSince(&start) - parseTime - sortTime;
+  free(keys);
+
+  printf("Read %d keys (%d distinct) from %s\n", count, distinct, path);
+  printf("parse: %.3f s, sort: %.3f s, build: %.3f s, total: %.3f s\n",
+      parseTime, sortTime, buildTime, secondsSince(&start));
+  if (compact)
+  {
+    printf("Compact arena: %u slots of %zu bytes\n", arena->capacity,
+        sizeof(compact_AVL_Node));
+  }
+  if (found)
+  {
+    printf("Closest pair found as (%d, %d).\n", closest.lower, closest.upper);
+  }
+  else
+  {
+    printf("Tree has less than 2 values\n");
+  }
+
+  if (compact)
+  {
+    deleteCompactArena(arena);
+  }
+  else
+  {
+    deleteTree(root);
+  }
+  return 0;
+}
@@ -0,0 +1,661 @@
+/*
+ *  Out-of-core closest-pair index implementation.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "closest_disk_tree.h"
+
+#define DISK_MAGIC "CAVLDISK"
+#define NO_PAGE UINT32_MAX
+
+// Header at the start of every tree page.
+typedef struct disk_page_header {
+  uint8_t isLeaf;
+  uint8_t unused;
+  uint16_t numKeys;   // keys in a leaf, children in an inner page
+  uint32_t next;      // next page of the free list (free pages only)
+} DiskPageHeader;
+
+/*
+ * A child of an inner page, which is also how a subtree is summarized. The
+ * subtree has a closest pair iff min < max.
+ */
+typedef struct disk_child {
+  uint32_t page;
+  int32_t min;
+  int32_t max;
+  int32_t lower;
+  int32_t upper;
+} DiskChild;
+
+typedef struct disk_meta {
+  char magic[8];
+  uint32_t root;
+  uint32_t height;
+  uint32_t numPages;
+  uint32_t freeHead;
+  long long count;
+} DiskMeta;
+
+#define LEAF_CAPACITY \
+  (int)((DISK_PAGE_SIZE - sizeof(DiskPageHeader)) / sizeof(int32_t))
+#define INNER_CAPACITY \
+  (int)((DISK_PAGE_SIZE - sizeof(DiskPageHeader)) / sizeof(DiskChild))
+
+#define PAGE_HEADER(data) ((DiskPageHeader * )(data))
+#define LEAF_KEYS(data) ((int32_t * )((data) + sizeof(DiskPageHeader)))
+#define INNER_CHILDREN(data) ((DiskChild * )((data) + sizeof(DiskPageHeader)))
+
+/*************************************************************************
+ ** Buffer pool
+ *************************************************************************/
+
+unsigned char * frameData(ClosestDiskTree * tree, int frame) {
+  return tree -> data + (size_t) frame * DISK_PAGE_SIZE;
+}
+
+bool readPage(ClosestDiskTree * tree, uint32_t page, unsigned char * data) {
+  tree -> pageReads++;
+  if (pread(tree -> fd, data, DISK_PAGE_SIZE,
+      (off_t) page * DISK_PAGE_SIZE) != DISK_PAGE_SIZE) {
+    tree -> failed = true;
+    return false;
+  }
+  return true;
+}
+
+void writePage(ClosestDiskTree * tree, uint32_t page, unsigned char * data) {
+  tree -> pageWrites++;
+  if (pwrite(tree -> fd, data, DISK_PAGE_SIZE,
+      (off_t) page * DISK_PAGE_SIZE) != DISK_PAGE_SIZE) {
+    tree -> failed = true;
+  }
+}
+
+// Removes 'frame' from the bucket chain of its page.
+void unhashFrame(ClosestDiskTree * tree, int frame) {
+  int * link = & tree -> buckets[tree -> frames[frame].page & tree -> bucketMask];
+  while ( * link != frame) {
+    link = & tree -> frames[ * link].hashNext;
+  }
+  * link = tree -> frames[frame].hashNext;
+}
+
+/*
+ * Picks an unpinned frame with the CLOCK algorithm (frames referenced since
+ * the hand last passed get a second chance), writes it back if dirty and
+ * detaches it from its page. Returns -1 if every frame is pinned.
+ */
+int evictFrame(ClosestDiskTree * tree) {
+  for (int steps = 0; steps < 2 * tree -> numFrames + 1; steps++) {
+    int frame = tree -> clockHand;
+    tree -> clockHand = (tree -> clockHand + 1) % tree -> numFrames;
+    DiskFrame * f = & tree -> frames[frame];
+    if (f -> pins > 0) {
+      continue;
+    }
+    if (f -> referenced) {
+      f -> referenced = false;
+      continue;
+    }
+    if (f -> page != NO_PAGE) {
+      if (f -> dirty) {
+        writePage(tree, f -> page, frameData(tree, frame));
+      }
+      unhashFrame(tree, frame);
+    }
+    f -> page = NO_PAGE;
+    f -> dirty = false;
+    return frame;
+  }
+  return -1;
+}
+
+/*
+ * Returns the frame holding 'page', pinned, reading the page in if it is
+ * not cached ('fresh' pages are zeroed instead). Returns -1, and flags the
+ * tree as failed, if every frame is pinned (operations rule this out up
+ * front with 'reserveFrames') or if the page cannot be read; in that case
+ * the frame stays free, so the next pin of the page tries to read it again.
+ */
+int pinPage(ClosestDiskTree * tree, uint32_t page, bool fresh) {
+  int frame = tree -> buckets[page & tree -> bucketMask];
+  while (frame >= 0 && tree -> frames[frame].page != page) {
+    frame = tree -> frames[frame].hashNext;
+  }
+  if (frame < 0) {
+    frame = evictFrame(tree);
+    if (frame < 0) {
+      tree -> failed = true;
+      return -1;
+    }
+    if (fresh) {
+      memset(frameData(tree, frame), 0, DISK_PAGE_SIZE);
+    } else if (!readPage(tree, page, frameData(tree, frame))) {
+      return -1;
+    }
+    DiskFrame * f = & tree -> frames[frame];
+    f -> page = page;
+    int * bucket = & tree -> buckets[page & tree -> bucketMask];
+    f -> hashNext = * bucket;
+    * bucket = frame;
+  }
+  if (tree -> frames[frame].pins++ == 0) {
+    tree -> pinnedFrames++;
+  }
+  tree -> frames[frame].referenced = true;
+  return frame;
+}
+
+void unpinPage(ClosestDiskTree * tree, int frame, bool dirty) {
+  if (--tree -> frames[frame].pins == 0) {
+    tree -> pinnedFrames--;
+  }
+  tree -> frames[frame].dirty |= dirty;
+}
+
+/*
+ * Returns true if at least 'needed' frames are unpinned. An operation that
+ * holds up to 'needed' pages pinned at once checks this before touching
+ * any page, so it cannot run out of frames halfway through an update;
+ * otherwise the tree is flagged as failed and the operation does nothing.
+ */
+bool reserveFrames(ClosestDiskTree * tree, int needed) {
+  if (tree -> numFrames - tree -> pinnedFrames < needed) {
+    tree -> failed = true;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Returns a pinned, zeroed frame for a new page; its number goes in 'page'.
+ * Cannot fail once the frame is reserved: if the head of the free list
+ * cannot be read, the file is extended instead, so that a split never
+ * stops halfway.
+ */
+int allocatePage(ClosestDiskTree * tree, bool isLeaf, uint32_t * page) {
+  int frame = -1;
+  if (tree -> freeHead != 0) {
+    * page = tree -> freeHead;
+    frame = pinPage(tree, * page, false);
+  }
+  if (frame >= 0) {
+    tree -> freeHead = PAGE_HEADER(frameData(tree, frame)) -> next;
+    memset(frameData(tree, frame), 0, DISK_PAGE_SIZE);
+  } else {
+    * page = tree -> numPages++;
+    frame = pinPage(tree, * page, true);
+  }
+  PAGE_HEADER(frameData(tree, frame)) -> isLeaf = isLeaf;
+  return frame;
+}
+
+// Puts the page in (pinned) 'frame' on the free list and unpins it.
+void freePage(ClosestDiskTree * tree, int frame) {
+  DiskPageHeader * header = PAGE_HEADER(frameData(tree, frame));
+  header -> numKeys = 0;
+  header -> next = tree -> freeHead;
+  tree -> freeHead = tree -> frames[frame].page;
+  unpinPage(tree, frame, true);
+}
+
+/*************************************************************************
+ ** Page helpers
+ *************************************************************************/
+
+bool hasPair(DiskChild * s) {
+  return s -> min < s -> max;
+}
+
+long long childGap(DiskChild * s) {
+  return (long long) s -> upper - s -> lower;
+}
+
+// Summarizes the leaf page 'page' held in 'data'.
+DiskChild summarizeLeaf(unsigned char * data, uint32_t page) {
+  int n = PAGE_HEADER(data) -> numKeys;
+  int32_t * keys = LEAF_KEYS(data);
+  DiskChild s = { page, 0, 0, 0, 0 };
+  if (n > 0) {
+    s.min = keys[0];
+    s.max = keys[n - 1];
+  }
+  for (int i = 1; i < n; i++) {
+    if (i == 1 || (long long) keys[i] - keys[i - 1] < childGap( & s)) {
+      s.lower = keys[i - 1];
+      s.upper = keys[i];
+    }
+  }
+  return s;
+}
+
+// Summarizes the inner page 'page' held in 'data' from its children.
+DiskChild summarizeInner(unsigned char * data, uint32_t page) {
+  int n = PAGE_HEADER(data) -> numKeys;
+  DiskChild * children = INNER_CHILDREN(data);
+  DiskChild s = { page, children[0].min, children[n - 1].max, 0, 0 };
+  bool found = false;
+  for (int i = 0; i < n; i++) {
+    if (hasPair( & children[i]) &&
+      (!found || childGap( & children[i]) < childGap( & s))) {
+      s.lower = children[i].lower;
+      s.upper = children[i].upper;
+      found = true;
+    }
+    if (i > 0 && (!found ||
+        (long long) children[i].min - children[i - 1].max < childGap( & s))) {
+      s.lower = children[i - 1].max;
+      s.upper = children[i].min;
+      found = true;
+    }
+  }
+  return s;
+}
+
+DiskChild summarizePage(unsigned char * data, uint32_t page) {
+  return PAGE_HEADER(data) -> isLeaf ? summarizeLeaf(data, page) :
+    summarizeInner(data, page);
+}
+
+// Returns the position of the first of the 'n' keys that is >= 'key'.
+int leafPosition(int32_t keys[], int n, int key) {
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (keys[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Returns the child whose subtree 'key' belongs to: the last one whose min
+// is <= 'key', or the first one.
+int childPosition(DiskChild children[], int n, int key) {
+  int lo = 0;
+  int hi = n - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (children[mid].min <= key) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+/*************************************************************************
+ ** Recursive updates
+ *************************************************************************/
+
+/*
+ * Inserts 'key' below 'page'. On return 'summary' describes 'page' and, if
+ * it had to be split, 'split' describes the new right sibling and
+ * '* didSplit' is true. Returns false, changing nothing, if 'key' was
+ * already present or a page on the way down could not be read.
+ */
+bool insertBelow(ClosestDiskTree * tree, uint32_t page, int key,
+  DiskChild * summary, DiskChild * split, bool * didSplit) {
+  int frame = pinPage(tree, page, false);
+  if (frame < 0) {
+    return false;
+  }
+  unsigned char * data = frameData(tree, frame);
+  DiskPageHeader * header = PAGE_HEADER(data);
+  * didSplit = false;
+
+  if (header -> isLeaf) {
+    int32_t * keys = LEAF_KEYS(data);
+    int n = header -> numKeys;
+    int i = leafPosition(keys, n, key);
+    if (i < n && keys[i] == key) {
+      unpinPage(tree, frame, false);
+      return false;
+    }
+    if (n < LEAF_CAPACITY) {
+      memmove(keys + i + 1, keys + i, sizeof(int32_t) * (n - i));
+      keys[i] = key;
+      header -> numKeys++;
+    } else {
+      // Move the upper half to a new leaf, then insert into the right half.
+      uint32_t rightPage;
+      int rightFrame = allocatePage(tree, true, & rightPage);
+      unsigned char * rightData = frameData(tree, rightFrame);
+      int32_t * rightKeys = LEAF_KEYS(rightData);
+      int half = n / 2;
+      memcpy(rightKeys, keys + half, sizeof(int32_t) * (n - half));
+      PAGE_HEADER(rightData) -> numKeys = n - half;
+      header -> numKeys = half;
+      if (i <= half) {
+        memmove(keys + i + 1, keys + i, sizeof(int32_t) * (half - i));
+        keys[i] = key;
+        header -> numKeys++;
+      } else {
+        int j = i - half;
+        memmove(rightKeys + j + 1, rightKeys + j,
+          sizeof(int32_t) * (n - half - j));
+        rightKeys[j] = key;
+        PAGE_HEADER(rightData) -> numKeys++;
+      }
+      * split = summarizeLeaf(rightData, rightPage);
+      * didSplit = true;
+      unpinPage(tree, rightFrame, true);
+    }
+    * summary = summarizeLeaf(data, page);
+    unpinPage(tree, frame, true);
+    return true;
+  }
+
+  DiskChild * children = INNER_CHILDREN(data);
+  int n = header -> numKeys;
+  int i = childPosition(children, n, key);
+  DiskChild childSplit;
+  bool childDidSplit;
+  if (!insertBelow(tree, children[i].page, key, & children[i], & childSplit,
+      & childDidSplit)) {
+    unpinPage(tree, frame, false);
+    return false;
+  }
+
+  if (childDidSplit) {
+    if (n < INNER_CAPACITY) {
+      memmove(children + i + 2, children + i + 1, sizeof(DiskChild) * (n - i - 1));
+      children[i + 1] = childSplit;
+      header -> numKeys++;
+    } else {
+      // Same as for leaves, with child entries instead of keys.
+      uint32_t rightPage;
+      int rightFrame = allocatePage(tree, false, & rightPage);
+      unsigned char * rightData = frameData(tree, rightFrame);
+      DiskChild * rightChildren = INNER_CHILDREN(rightData);
+      int half = n / 2;
+      memcpy(rightChildren, children + half, sizeof(DiskChild) * (n - half));
+      PAGE_HEADER(rightData) -> numKeys = n - half;
+      header -> numKeys = half;
+      if (i + 1 <= half) {
+        memmove(children + i + 2, children + i + 1,
+          sizeof(DiskChild) * (half - i - 1));
+        children[i + 1] = childSplit;
+        header -> numKeys++;
+      } else {
+        int j = i + 1 - half;
+        memmove(rightChildren + j + 1, rightChildren + j,
+          sizeof(DiskChild) * (n - half - j));
+        rightChildren[j] = childSplit;
+        PAGE_HEADER(rightData) -> numKeys++;
+      }
+      * split = summarizeInner(rightData, rightPage);
+      * didSplit = true;
+      unpinPage(tree, rightFrame, true);
+    }
+  }
+  * summary = summarizeInner(data, page);
+  unpinPage(tree, frame, true);
+  return true;
+}
+
+/*
+ * Deletes 'key' below 'page'. On return 'summary' describes 'page', unless
+ * it became empty, in which case it has been freed (if not the root) and
+ * '* emptied' is true. Returns false, changing nothing, if 'key' was not
+ * present or a page on the way down could not be read.
+ */
+bool deleteBelow(ClosestDiskTree * tree, uint32_t page, int key,
+  DiskChild * summary, bool * emptied) {
+  int frame = pinPage(tree, page, false);
+  if (frame < 0) {
+    return false;
+  }
+  unsigned char * data = frameData(tree, frame);
+  DiskPageHeader * header = PAGE_HEADER(data);
+  int n = header -> numKeys;
+  * emptied = false;
+
+  if (header -> isLeaf) {
+    int32_t * keys = LEAF_KEYS(data);
+    int i = leafPosition(keys, n, key);
+    if (i == n || keys[i] != key) {
+      unpinPage(tree, frame, false);
+      return false;
+    }
+    memmove(keys + i, keys + i + 1, sizeof(int32_t) * (n - i - 1));
+    header -> numKeys--;
+  } else {
+    DiskChild * children = INNER_CHILDREN(data);
+    int i = childPosition(children, n, key);
+    bool childEmptied;
+    if (!deleteBelow(tree, children[i].page, key, & children[i],
+        & childEmptied)) {
+      unpinPage(tree, frame, false);
+      return false;
+    }
+    if (childEmptied) {
+      memmove(children + i, children + i + 1, sizeof(DiskChild) * (n - i - 1));
+      header -> numKeys--;
+    }
+  }
+
+  if (header -> numKeys == 0 && page != tree -> root) {
+    * emptied = true;
+    freePage(tree, frame);
+    return true;
+  }
+  * emptied = header -> numKeys == 0;
+  if (!* emptied) {
+    * summary = summarizePage(data, page);
+  }
+  unpinPage(tree, frame, true);
+  return true;
+}
+
+/*************************************************************************
+ ** Tree operations
+ *************************************************************************/
+
+ClosestDiskTree * openDiskTree(const char * path, int poolPages) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  DiskMeta meta;
+  ssize_t got = pread(fd, & meta, sizeof(DiskMeta), 0);
+  if (got != 0 && (got != sizeof(DiskMeta) ||
+      memcmp(meta.magic, DISK_MAGIC, 8) != 0)) {
+    close(fd);
+    return NULL;
+  }
+
+  if (poolPages < DISK_MIN_POOL_PAGES) {
+    poolPages = DISK_MIN_POOL_PAGES;
+  }
+  ClosestDiskTree * tree = malloc(sizeof(ClosestDiskTree));
+  tree -> fd = fd;
+  tree -> numFrames = poolPages;
+  if (posix_memalign((void ** ) & tree -> data, DISK_PAGE_SIZE,
+      (size_t) poolPages * DISK_PAGE_SIZE) != 0) {
+    close(fd);
+    free(tree);
+    return NULL;
+  }
+  tree -> frames = malloc(sizeof(DiskFrame) * poolPages);
+  for (int i = 0; i < poolPages; i++) {
+    tree -> frames[i].page = NO_PAGE;
+    tree -> frames[i].pins = 0;
+    tree -> frames[i].dirty = false;
+    tree -> frames[i].referenced = false;
+    tree -> frames[i].hashNext = -1;
+  }
+  tree -> clockHand = 0;
+  tree -> pinnedFrames = 0;
+  uint32_t buckets = 1;
+  while (buckets < (uint32_t) poolPages) {
+    buckets *= 2;
+  }
+  tree -> buckets = malloc(sizeof(int) * buckets);
+  memset(tree -> buckets, -1, sizeof(int) * buckets);
+  tree -> bucketMask = buckets - 1;
+  tree -> pageReads = 0;
+  tree -> pageWrites = 0;
+  tree -> failed = false;
+
+  if (got == 0) {
+    // New file: page 0 is the meta page, page 1 an empty root leaf.
+    tree -> numPages = 1;
+    tree -> freeHead = 0;
+    tree -> height = 1;
+    tree -> count = 0;
+    int frame = allocatePage(tree, true, & tree -> root);
+    unpinPage(tree, frame, true);
+  } else {
+    tree -> root = meta.root;
+    tree -> height = meta.height;
+    tree -> numPages = meta.numPages;
+    tree -> freeHead = meta.freeHead;
+    tree -> count = meta.count;
+  }
+  return tree;
+}
+
+bool diskSearch(ClosestDiskTree * tree, int key) {
+  if (!reserveFrames(tree, 1)) {
+    return false;
+  }
+  uint32_t page = tree -> root;
+  while (true) {
+    int frame = pinPage(tree, page, false);
+    if (frame < 0) {
+      return false;
+    }
+    unsigned char * data = frameData(tree, frame);
+    int n = PAGE_HEADER(data) -> numKeys;
+    if (PAGE_HEADER(data) -> isLeaf) {
+      int32_t * keys = LEAF_KEYS(data);
+      int i = leafPosition(keys, n, key);
+      bool found = i < n && keys[i] == key;
+      unpinPage(tree, frame, false);
+      return found;
+    }
+    DiskChild * children = INNER_CHILDREN(data);
+    page = children[childPosition(children, n, key)].page;
+    unpinPage(tree, frame, false);
+  }
+}
+
+void diskInsert(ClosestDiskTree * tree, int key) {
+  // One page per level, plus the new sibling of a page being split.
+  DiskChild summary, split;
+  bool didSplit;
+  if (!reserveFrames(tree, tree -> height + 1) ||
+    !insertBelow(tree, tree -> root, key, & summary, & split, & didSplit)) {
+    return;
+  }
+  tree -> count++;
+  if (didSplit) {
+    // Grow a level: the new root has the old root and its sibling.
+    uint32_t rootPage;
+    int frame = allocatePage(tree, false, & rootPage);
+    unsigned char * data = frameData(tree, frame);
+    INNER_CHILDREN(data)[0] = summary;
+    INNER_CHILDREN(data)[1] = split;
+    PAGE_HEADER(data) -> numKeys = 2;
+    unpinPage(tree, frame, true);
+    tree -> root = rootPage;
+    tree -> height++;
+  }
+}
+
+void diskDelete(ClosestDiskTree * tree, int key) {
+  // One page per level; shrinking the root afterwards needs at most one.
+  DiskChild summary;
+  bool emptied;
+  if (!reserveFrames(tree, tree -> height) ||
+    !deleteBelow(tree, tree -> root, key, & summary, & emptied)) {
+    return;
+  }
+  tree -> count--;
+
+  // Shrink while the root has a single child; an emptied inner root is
+  // replaced by an empty leaf.
+  while (tree -> height > 1) {
+    // A root that cannot be read is left as it is: a single-child root is
+    // still a valid tree.
+    int frame = pinPage(tree, tree -> root, false);
+    if (frame < 0) {
+      break;
+    }
+    unsigned char * data = frameData(tree, frame);
+    int n = PAGE_HEADER(data) -> numKeys;
+    if (n > 1) {
+      unpinPage(tree, frame, false);
+      break;
+    }
+    uint32_t child = (n == 1) ? INNER_CHILDREN(data)[0].page : NO_PAGE;
+    freePage(tree, frame);
+    if (child == NO_PAGE) {
+      frame = allocatePage(tree, true, & tree -> root);
+      unpinPage(tree, frame, true);
+      tree -> height = 1;
+    } else {
+      tree -> root = child;
+      tree -> height--;
+    }
+  }
+}
+
+bool diskGetClosestPair(ClosestDiskTree * tree, pair * result) {
+  if (tree -> count < 2 || !reserveFrames(tree, 1)) {
+    return false;
+  }
+  int frame = pinPage(tree, tree -> root, false);
+  if (frame < 0) {
+    return false;
+  }
+  DiskChild s = summarizePage(frameData(tree, frame), tree -> root);
+  unpinPage(tree, frame, false);
+  result -> lower = s.lower;
+  result -> upper = s.upper;
+  return true;
+}
+
+bool diskTreeSync(ClosestDiskTree * tree) {
+  for (int i = 0; i < tree -> numFrames; i++) {
+    DiskFrame * f = & tree -> frames[i];
+    if (f -> page != NO_PAGE && f -> dirty) {
+      writePage(tree, f -> page, frameData(tree, i));
+      f -> dirty = false;
+    }
+  }
+
+  unsigned char page[DISK_PAGE_SIZE] = { 0 };
+  DiskMeta * meta = (DiskMeta * ) page;
+  memcpy(meta -> magic, DISK_MAGIC, 8);
+  meta -> root = tree -> root;
+  meta -> height = tree -> height;
+  meta -> numPages = tree -> numPages;
+  meta -> freeHead = tree -> freeHead;
+  meta -> count = tree -> count;
+  writePage(tree, 0, page);
+  if (fsync(tree -> fd) != 0) {
+    tree -> failed = true;
+  }
+  return !tree -> failed;
+}
+
+bool closeDiskTree(ClosestDiskTree * tree) {
+  bool ok = diskTreeSync(tree);
+  close(tree -> fd);
+  free(tree -> data);
+  free(tree -> frames);
+  free(tree -> buckets);
+  free(tree);
+  return ok;
+}
@@ -0,0 +1,104 @@
+/*
+ *  Header file for the out-of-core closest-pair index.
+ *
+ *  A B+ tree stored in a local file of DISK_PAGE_SIZE pages, read and
+ *  written with pread/pwrite through a bounded buffer pool with CLOCK
+ *  replacement. Leaves hold sorted keys; inner pages hold, for each child,
+ *  its page number and the min, max and closest pair of its subtree, so
+ *  search, insert and delete touch one page per level (O(log_B n) pages)
+ *  and the closest pair of the whole set is read off the root page.
+ *
+ *  Page 0 holds the tree's metadata. Pages emptied by deletes go on a free
+ *  list; underfull pages are not merged. Like the journal, only keys are
+ *  stored. Updates reach the file when their page is evicted or on
+ *  diskTreeSync/closeDiskTree; the file is not crash-consistent between
+ *  syncs.
+ *
+ *  Errors are sticky: an I/O error, or an operation that could not get
+ *  enough buffer pool frames (and so was skipped), sets 'failed', which
+ *  diskTreeSync and closeDiskTree report. An operation that cannot read a
+ *  page it needs stops before changing anything; a search then reports
+ *  the key as missing.
+ */
+
+#include <stdint.h>
+
+#include "closest_AVL_tree.h"
+
+#ifndef __closest_disk_tree_header
+#define __closest_disk_tree_header
+
+#define DISK_PAGE_SIZE 4096
+#define DISK_MIN_POOL_PAGES 32
+
+typedef struct disk_frame
+{
+  uint32_t page;      // page held by this frame, or UINT32_MAX if none
+  int pins;           // number of users; pinned frames are never evicted
+  bool dirty;         // must be written back before reuse
+  bool referenced;    // CLOCK reference bit
+  int hashNext;       // next frame in the same page-table bucket, or -1
+} DiskFrame;
+
+typedef struct closest_disk_tree
+{
+  int fd;
+  unsigned char* data;    // numFrames pages, DISK_PAGE_SIZE-aligned
+  DiskFrame* frames;
+  int numFrames;
+  int clockHand;
+  int pinnedFrames;       // frames with pins > 0
+  int* buckets;           // page table: first frame of each bucket, or -1
+  uint32_t bucketMask;
+  uint32_t root;          // root page
+  uint32_t height;        // number of levels, 1 if the root is a leaf
+  uint32_t numPages;      // pages in the file, meta page included
+  uint32_t freeHead;      // first page of the free list, 0 if empty
+  long long count;        // number of keys stored
+  long pageReads;         // pages read from the file
+  long pageWrites;        // pages written to the file
+  bool failed;            // an I/O error occurred, or an operation was
+                          // refused because too many frames were pinned
+} ClosestDiskTree;
+
+/*
+ * Opens the tree stored in the file at 'path', creating an empty one if
+ * the file does not exist or is empty, with a buffer pool of 'poolPages'
+ * pages (at least DISK_MIN_POOL_PAGES). Returns NULL if the file cannot be
+ * opened or is not a tree.
+ */
+ClosestDiskTree* openDiskTree(const char* path, int poolPages);
+
+/*
+ * Returns true iff 'key' is in 'tree'.
+ */
+bool diskSearch(ClosestDiskTree* tree, int key);
+
+/*
+ * Inserts 'key' into 'tree'. Has no effect if 'key' is already present.
+ */
+void diskInsert(ClosestDiskTree* tree, int key);
+
+/*
+ * Deletes 'key' from 'tree'. Has no effect if 'key' is not in 'tree'.
+ */
+void diskDelete(ClosestDiskTree* tree, int key);
+
+/*
+ * Stores the closest pair of keys in 'tree' in 'result' and returns true,
+ * or returns false if 'tree' has less than 2 keys. Reads only the root.
+ */
+bool diskGetClosestPair(ClosestDiskTree* tree, pair* result);
+
+/*
+ * Writes every dirty page and the metadata to the file and fsyncs it.
+ * Returns true iff no error has occurred (see 'failed').
+ */
+bool diskTreeSync(ClosestDiskTree* tree);
+
+/*
+ * Syncs 'tree' and frees it. Returns the result of the sync.
+ */
+bool closeDiskTree(ClosestDiskTree* tree);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ *  Model test of the out-of-core closest-pair index: random inserts and
+ *  deletes are applied both to a disk tree with the smallest buffer pool
+ *  (DISK_MIN_POOL_PAGES pages, so pages are evicted and read back all the
+ *  time) and to a plain array of flags, and the count, searches and the
+ *  closest pair are compared. The tree is then reopened from its file,
+ *  the buffer pool is exhausted on purpose, which must be reported as an
+ *  error rather than crash, and finally some pages cannot be read (the
+ *  tester is linked with pread wrapped, see the Makefile), which must make
+ *  the operations that need them change nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "closest_disk_tree.h"
+
+#define KEY_RANGE 300000
+#define OPERATIONS 200000
+#define CHECK_EVERY 2000
+
+// Buffer pool internals of closest_disk_tree.c, used to pin frames.
+int pinPage(ClosestDiskTree* tree, uint32_t page, bool fresh);
+void unpinPage(ClosestDiskTree* tree, int frame, bool dirty);
+
+char path[] = "/tmp/closest_disk_tree_XXXXXX";
+bool model[KEY_RANGE];  // model[k] is true if key k is in the tree
+bool failReads = false; // make reads of every third page fail
+
+ssize_t __real_pread(int fd, void* buffer, size_t count, off_t offset);
+
+ssize_t __wrap_pread(int fd, void* buffer, size_t count, off_t offset)
+{
+  uint32_t page = offset / DISK_PAGE_SIZE;
+  if (failReads && page != 0 && page % 3 == 0)
+  {
+    return -1;
+  }
+  return __real_pread(fd, buffer, count, offset);
+}
+
+/*
+ * Returns true if 'tree' has the model's count and closest pair, and
+ * agrees with it on a few random searches.
+ */
+bool matchesModel(ClosestDiskTree* tree)
+{
+  long long count = 0;
+  long long best = -1;
+  int previous = -1;
+  for (int key = 0; key < KEY_RANGE; key++)
+  {
+    if (model[key])
+    {
+      count++;
+      if (previous >= 0 && (best < 0 || key - previous < best))
+      {
+        best = key - previous;
+      }
+      previous = key;
+    }
+  }
+  pair closest;
+  bool found = diskGetClosestPair(tree, &closest);
+  if (count != tree->count || found != (best >= 0) ||
+      (found && (closest.upper - closest.lower != best ||
+                 !model[closest.lower] || !model[closest.upper])))
+  {
+    return false;
+  }
+  for (int i = 0; i < 20; i++)
+  {
+    int key = rand() % KEY_RANGE;
+    if (diskSearch(tree, key) != model[key])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main()
+{
+  srand(3);
+  int fd = mkstemp(path);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Unable to create a temporary tree file\n");
+    return 1;
+  }
+  close(fd);
+
+  // 1. Mostly inserts, then mostly deletes, so that pages split, empty
+  // out and are reused from the free list.
+  ClosestDiskTree* tree = openDiskTree(path, DISK_MIN_POOL_PAGES);
+  bool ok = tree != NULL;
+  for (int i = 0; ok && i < OPERATIONS; i++)
+  {
+    int key = rand() % KEY_RANGE;
+    bool insert = (i < OPERATIONS * 2 / 3) ? rand() % 5 != 0 : rand() % 5 == 0;
+    if (insert)
+    {
+      diskInsert(tree, key);
+    }
+    else
+    {
+      diskDelete(tree, key);
+    }
+    model[key] = insert;
+    if (i % CHECK_EVERY == 0 && !matchesModel(tree))
+    {
+      printf("FAILED after %d operations\n", i);
+      ok = false;
+    }
+  }
+  ok = ok && matchesModel(tree) && closeDiskTree(tree);
+
+  // 2. Reopen from the file.
+  tree = ok ? openDiskTree(path, DISK_MIN_POOL_PAGES) : NULL;
+  ok = tree != NULL && matchesModel(tree);
+
+  // 3. With all but one frame pinned, an insert cannot get a frame for
+  // every level plus a split; it must be refused and leave the tree as it
+  // was, and the error must show up when the tree is closed.
+  int frames[DISK_MIN_POOL_PAGES];
+  int pinned = 0;
+  for (uint32_t page = 1; ok && pinned < DISK_MIN_POOL_PAGES - 1 &&
+       page < tree->numPages; page++)
+  {
+    frames[pinned++] = pinPage(tree, page, false);
+  }
+  ok = ok && pinned == DISK_MIN_POOL_PAGES - 1 && tree->height >= 2;
+  if (ok)
+  {
+    int key = 0;
+    while (model[key])
+    {
+      key++;
+    }
+    diskInsert(tree, key);
+    ok = tree->failed && !diskSearch(tree, key);
+    // the last frame can be pinned, and then no other page can be
+    frames[pinned++] = pinPage(tree, tree->numPages - 1, false);
+    ok = ok && frames[pinned - 1] >= 0 && pinPage(tree, 1, false) >= 0;
+    ok = ok && pinPage(tree, tree->numPages - 2, false) == -1;
+    unpinPage(tree, frames[0], false);  // page 1 was pinned twice
+    for (int i = 0; i < pinned; i++)
+    {
+      unpinPage(tree, frames[i], false);
+    }
+    ok = ok && tree->pinnedFrames == 0 && matchesModel(tree);
+    ok = ok && !closeDiskTree(tree);
+    tree = openDiskTree(path, DISK_MIN_POOL_PAGES);
+    ok = ok && tree != NULL && matchesModel(tree) && closeDiskTree(tree);
+  }
+
+  // 4. Some pages cannot be read. An operation that needs one must change
+  // nothing (so the count tells whether it went through), and the error
+  // must show up when the tree is closed; once the pages can be read
+  // again, the tree must match the model.
+  tree = ok ? openDiskTree(path, DISK_MIN_POOL_PAGES) : NULL;
+  ok = tree != NULL;
+  failReads = true;
+  int refused = 0;
+  for (int i = 0; ok && i < OPERATIONS / 10; i++)
+  {
+    int key = rand() % KEY_RANGE;
+    bool insert = rand() % 2 == 0;
+    long long count = tree->count;
+    if (insert)
+    {
+      diskInsert(tree, key);
+    }
+    else
+    {
+      diskDelete(tree, key);
+    }
+    if (tree->count != count)
+    {
+      model[key] = insert;
+    }
+    refused += model[key] != insert;
+    pair closest;
+    diskGetClosestPair(tree, &closest);
+    ok = !diskSearch(tree, key) || model[key];
+  }
+  ok = ok && tree->failed && refused > 0 && !closeDiskTree(tree);
+  failReads = false;
+  tree = ok ? openDiskTree(path, DISK_MIN_POOL_PAGES) : NULL;
+  ok = tree != NULL && matchesModel(tree) && closeDiskTree(tree);
+
+  unlink(path);
+  printf(ok ? "All disk tree tests passed\n" : "FAILED\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+/*
+ *  Closest-pair forest implementation.
+ */
+
+#include <string.h>
+
+#include "closest_forest.h"
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+// Recomputes the cached closest pair of an inline entity.
+void updateInlinePair(ForestEntity * e) {
+  for (uint32_t i = 1; i < e -> size; i++) {
+    if (i == 1 || (long long) e -> keys[i] - e -> keys[i - 1] <
+      (long long) e -> upper - e -> lower) {
+      e -> lower = e -> keys[i - 1];
+      e -> upper = e -> keys[i];
+    }
+  }
+}
+
+// Returns the position of the first inline key that is >= 'key'.
+uint32_t inlinePosition(ForestEntity * e, int key) {
+  uint32_t i = 0;
+  while (i < e -> size && e -> keys[i] < key) {
+    i++;
+  }
+  return i;
+}
+
+/*
+ * Makes sure 'entity' exists, growing the entity array by doubling.
+ * Returns false if out of memory, or if 'entity' is UINT32_MAX.
+ */
+bool reserveEntity(ClosestForest * forest, uint32_t entity) {
+  if (entity < forest -> numEntities) {
+    return true;
+  }
+  if (entity == UINT32_MAX) {
+    return false;
+  }
+  uint32_t numEntities = (forest -> numEntities > 0) ? forest -> numEntities : 1;
+  while (numEntities <= entity) {
+    // Doubling must not wrap around to a smaller count.
+    numEntities = (numEntities > UINT32_MAX / 2) ? UINT32_MAX : 2 * numEntities;
+  }
+  ForestEntity * entities = realloc(forest -> entities,
+    sizeof(ForestEntity) * (size_t) numEntities);
+  if (entities == NULL) {
+    return false;
+  }
+  memset(entities + forest -> numEntities, 0,
+    sizeof(ForestEntity) * (numEntities - forest -> numEntities));
+  forest -> entities = entities;
+  forest -> numEntities = numEntities;
+  return true;
+}
+
+/*
+ * Moves the inline keys of 'e' plus 'key' into a tree in the arena.
+ * Returns false, leaving 'e' inline and unchanged, if the arena is full.
+ */
+bool promoteEntity(ClosestForest * forest, ForestEntity * e, int key) {
+  uint32_t root = COMPACT_NIL;
+  for (uint32_t i = 0; i <= e -> size; i++) {
+    if (!compactReserve(forest -> arena)) {
+      compactDeleteTree(forest -> arena, root);
+      return false;
+    }
+    root = compactInsert(forest -> arena, root,
+      (i < e -> size) ? e -> keys[i] : key, NULL);
+  }
+  e -> root = root;
+  e -> promoted = true;
+  return true;
+}
+
+// Appends the keys of the tree rooted at 'node' to 'keys' in order.
+uint32_t collectKeys(compact_AVL_Arena * arena, uint32_t node, int keys[],
+  uint32_t count) {
+  if (node == COMPACT_NIL) {
+    return count;
+  }
+  count = collectKeys(arena, arena -> nodes[node].left, keys, count);
+  keys[count++] = arena -> nodes[node].key;
+  return collectKeys(arena, arena -> nodes[node].right, keys, count);
+}
+
+// Moves the keys of the tree of 'e' back inline.
+void demoteEntity(ClosestForest * forest, ForestEntity * e) {
+  int keys[FOREST_INLINE_KEYS];
+  uint32_t root = e -> root;
+  collectKeys(forest -> arena, root, keys, 0);
+  compactDeleteTree(forest -> arena, root);
+  memcpy(e -> keys, keys, sizeof(int) * e -> size);
+  e -> promoted = false;
+  updateInlinePair(e);
+}
+
+/*************************************************************************
+ ** Forest operations
+ *************************************************************************/
+
+ClosestForest * newForest(uint32_t numEntities) {
+  ClosestForest * forest = malloc(sizeof(ClosestForest));
+  if (forest == NULL) {
+    return NULL;
+  }
+  forest -> entities = calloc(numEntities > 0 ? numEntities : 1,
+    sizeof(ForestEntity));
+  forest -> numEntities = numEntities;
+  forest -> arena = newCompactArena(1024);
+  if (forest -> entities == NULL || forest -> arena == NULL) {
+    free(forest -> entities);
+    if (forest -> arena != NULL) {
+      deleteCompactArena(forest -> arena);
+    }
+    free(forest);
+    return NULL;
+  }
+  return forest;
+}
+
+bool forestSearch(ClosestForest * forest, uint32_t entity, int key) {
+  if (entity >= forest -> numEntities) {
+    return false;
+  }
+  ForestEntity * e = & forest -> entities[entity];
+  if (e -> promoted) {
+    return compactSearch(forest -> arena, e -> root, key) != COMPACT_NIL;
+  }
+  uint32_t i = inlinePosition(e, key);
+  return i < e -> size && e -> keys[i] == key;
+}
+
+bool forestInsert(ClosestForest * forest, uint32_t entity, int key) {
+  if (!reserveEntity(forest, entity)) {
+    return false;
+  }
+  ForestEntity * e = & forest -> entities[entity];
+  if (e -> promoted) {
+    if (compactSearch(forest -> arena, e -> root, key) == COMPACT_NIL) {
+      if (!compactReserve(forest -> arena)) {
+        return false;
+      }
+      e -> root = compactInsert(forest -> arena, e -> root, key, NULL);
+      e -> size++;
+    }
+    return true;
+  }
+
+  uint32_t i = inlinePosition(e, key);
+  if (i < e -> size && e -> keys[i] == key) {
+    return true;
+  }
+  if (e -> size == FOREST_INLINE_KEYS) {
+    if (!promoteEntity(forest, e, key)) {
+      return false;
+    }
+    e -> size++;
+    return true;
+  }
+  memmove(e -> keys + i + 1, e -> keys + i, sizeof(int) * (e -> size - i));
+  e -> keys[i] = key;
+  e -> size++;
+  updateInlinePair(e);
+  return true;
+}
+
+void forestDelete(ClosestForest * forest, uint32_t entity, int key) {
+  if (entity >= forest -> numEntities) {
+    return;
+  }
+  ForestEntity * e = & forest -> entities[entity];
+  if (e -> promoted) {
+    if (compactSearch(forest -> arena, e -> root, key) != COMPACT_NIL) {
+      e -> root = compactDelete(forest -> arena, e -> root, key);
+      e -> size--;
+      if (e -> size <= FOREST_DEMOTE_KEYS) {
+        demoteEntity(forest, e);
+      }
+    }
+    return;
+  }
+
+  uint32_t i = inlinePosition(e, key);
+  if (i < e -> size && e -> keys[i] == key) {
+    memmove(e -> keys + i, e -> keys + i + 1,
+      sizeof(int) * (e -> size - i - 1));
+    e -> size--;
+    updateInlinePair(e);
+  }
+}
+
+bool forestGetClosestPair(ClosestForest * forest, uint32_t entity,
+  pair * result) {
+  if (entity >= forest -> numEntities) {
+    return false;
+  }
+  ForestEntity * e = & forest -> entities[entity];
+  if (e -> promoted) {
+    return compactGetClosestPair(forest -> arena, e -> root, result);
+  }
+  if (e -> size < 2) {
+    return false;
+  }
+  result -> lower = e -> lower;
+  result -> upper = e -> upper;
+  return true;
+}
+
+uint32_t forestSize(ClosestForest * forest, uint32_t entity) {
+  return (entity < forest -> numEntities) ? forest -> entities[entity].size : 0;
+}
+
+void deleteForest(ClosestForest * forest) {
+  deleteCompactArena(forest -> arena);
+  free(forest -> entities);
+  free(forest);
+}
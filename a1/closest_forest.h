@@ -0,0 +1,88 @@
+/*
+ *  Header file for closest-pair forests.
+ *
+ *  A forest keeps one closest-pair key set per entity, for many entities
+ *  with few keys each. Entities are numbered densely from 0. A set of up
+ *  to FOREST_INLINE_KEYS keys is stored inline in its entity record as a
+ *  sorted array with a cached closest pair; past that it is promoted to a
+ *  compact closest-AVL tree in an arena shared by the whole forest, and it
+ *  is demoted back once it shrinks to FOREST_DEMOTE_KEYS keys (the gap
+ *  between the two avoids flip-flopping). Only keys are stored.
+ *
+ *  An entity record is 48 bytes, so an entity with 8 keys costs 48 bytes
+ *  instead of 8 nodes + 7 pairs from malloc, and larger ones cost 32 bytes
+ *  per key in the arena.
+ */
+
+#include <stdint.h>
+
+#include "closest_AVL_tree.h"
+#include "compact_AVL_tree.h"
+
+#ifndef __closest_forest_header
+#define __closest_forest_header
+
+#define FOREST_INLINE_KEYS 8
+#define FOREST_DEMOTE_KEYS 4
+
+typedef struct forest_entity
+{
+  union {
+    int keys[FOREST_INLINE_KEYS]; // sorted keys, when inline
+    uint32_t root;                // root in the shared arena, when promoted
+  };
+  int lower;          // cached closest pair, when inline and size > 1
+  int upper;
+  uint32_t size;      // number of keys
+  bool promoted;      // keys live in the arena
+} ForestEntity;
+
+typedef struct closest_forest
+{
+  ForestEntity* entities;
+  uint32_t numEntities;
+  compact_AVL_Arena* arena;   // nodes of every promoted entity
+} ClosestForest;
+
+/*
+ * Returns a new forest of 'numEntities' entities with no keys, or NULL if
+ * out of memory. The forest grows when a larger entity number is inserted
+ * into.
+ */
+ClosestForest* newForest(uint32_t numEntities);
+
+/*
+ * Returns true iff 'key' is in the set of 'entity'.
+ */
+bool forestSearch(ClosestForest* forest, uint32_t entity, int key);
+
+/*
+ * Inserts 'key' into the set of 'entity'. Has no effect if it is already
+ * there. Returns false, leaving the forest unchanged, if it cannot grow
+ * (out of memory, or out of entity numbers or arena indices).
+ */
+bool forestInsert(ClosestForest* forest, uint32_t entity, int key);
+
+/*
+ * Deletes 'key' from the set of 'entity'. Has no effect if it is not there.
+ */
+void forestDelete(ClosestForest* forest, uint32_t entity, int key);
+
+/*
+ * Stores the closest pair of keys of 'entity' in 'result' and returns
+ * true, or returns false if it has less than 2 keys. O(1).
+ */
+bool forestGetClosestPair(ClosestForest* forest, uint32_t entity,
+    pair* result);
+
+/*
+ * Returns the number of keys of 'entity'.
+ */
+uint32_t forestSize(ClosestForest* forest, uint32_t entity);
+
+/*
+ * Frees all memory allocated for 'forest'.
+ */
+void deleteForest(ClosestForest* forest);
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ *  Packed-memory-array closest-pair backend implementation.
+ */
+
+#include <string.h>
+
+#include "closest_pma.h"
+
+#define PMA_ROOT_DENSITY 0.75  // upper density bound of the whole array
+#define PMA_MIN_DENSITY 0.125  // below this the array is halved
+
+/*************************************************************************
+ ** Index helpers
+ *************************************************************************/
+
+long long pmaGap(pair * p) {
+  return (long long) p -> upper - p -> lower;
+}
+
+// Returns the summary of two adjacent key sets, 'a' before 'b'.
+PMASummary mergeSummaries(PMASummary a, PMASummary b) {
+  if (a.count == 0) {
+    return b;
+  }
+  if (b.count == 0) {
+    return a;
+  }
+  PMASummary s;
+  s.count = a.count + b.count;
+  s.min = a.min;
+  s.max = b.max;
+  s.closest.lower = a.max;
+  s.closest.upper = b.min;
+  if (a.count > 1 && pmaGap( & a.closest) < pmaGap( & s.closest)) {
+    s.closest = a.closest;
+  }
+  if (b.count > 1 && pmaGap( & b.closest) < pmaGap( & s.closest)) {
+    s.closest = b.closest;
+  }
+  return s;
+}
+
+// Returns the summary of the 'n' sorted keys in 'keys'.
+PMASummary summarizeKeys(int keys[], int n) {
+  PMASummary s;
+  s.count = n;
+  if (n > 0) {
+    s.min = keys[0];
+    s.max = keys[n - 1];
+  }
+  for (int i = 1; i < n; i++) {
+    if (i == 1 || (long long) keys[i] - keys[i - 1] < pmaGap( & s.closest)) {
+      s.closest.lower = keys[i - 1];
+      s.closest.upper = keys[i];
+    }
+  }
+  return s;
+}
+
+// Recomputes the index over segments 'first'..'last' and their ancestors.
+void refreshIndex(ClosestPMA * pma, int first, int last) {
+  for (int s = first; s <= last; s++) {
+    pma -> index[pma -> numSegments + s] = summarizeKeys(
+      & pma -> keys[(long) s * PMA_SEGMENT_SIZE], pma -> segmentCount[s]);
+  }
+  long lo = pma -> numSegments + first;
+  long hi = pma -> numSegments + last;
+  while (lo > 1) {
+    lo /= 2;
+    hi /= 2;
+    for (long node = lo; node <= hi; node++) {
+      pma -> index[node] = mergeSummaries(pma -> index[2 * node],
+        pma -> index[2 * node + 1]);
+    }
+  }
+}
+
+/*
+ * Returns the segment 'key' belongs to: every key in the segments before it
+ * is smaller than 'key', and every key in the segments after it is larger.
+ */
+int findSegment(ClosestPMA * pma, int key) {
+  long node = 1;
+  while (node < pma -> numSegments) {
+    PMASummary * right = & pma -> index[2 * node + 1];
+    node = (right -> count > 0 && key >= right -> min) ? 2 * node + 1 : 2 * node;
+  }
+  return node - pma -> numSegments;
+}
+
+// Returns the position of the first of the 'n' keys that is >= 'key'.
+int lowerBound(int keys[], int n, int key) {
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (keys[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/*************************************************************************
+ ** Rebalancing
+ *************************************************************************/
+
+/*
+ * Copies the keys (and values) of segments 'first'..'last', in order, to
+ * 'keys' (and 'values' if the array has values). Returns how many.
+ */
+long gatherKeys(ClosestPMA * pma, int first, int last, int keys[],
+  void * values[]) {
+  long n = 0;
+  for (int s = first; s <= last; s++) {
+    long start = (long) s * PMA_SEGMENT_SIZE;
+    int count = pma -> segmentCount[s];
+    memcpy(keys + n, pma -> keys + start, sizeof(int) * count);
+    if (pma -> values != NULL) {
+      memcpy(values + n, pma -> values + start, sizeof(void * ) * count);
+    }
+    n += count;
+  }
+  return n;
+}
+
+// Spreads the 'n' keys evenly over segments 'first'..'last'.
+void spreadKeys(ClosestPMA * pma, int first, int last, int keys[],
+  void * values[], long n) {
+  int segments = last - first + 1;
+  long done = 0;
+  for (int s = first; s <= last; s++) {
+    int count = n / segments + (s - first < n % segments);
+    long start = (long) s * PMA_SEGMENT_SIZE;
+    memcpy(pma -> keys + start, keys + done, sizeof(int) * count);
+    if (pma -> values != NULL) {
+      memcpy(pma -> values + start, values + done, sizeof(void * ) * count);
+    }
+    pma -> segmentCount[s] = count;
+    done += count;
+  }
+  refreshIndex(pma, first, last);
+}
+
+// Evens out the keys of segments 'first'..'last'.
+void rebalanceWindow(ClosestPMA * pma, int first, int last) {
+  long slots = (long)(last - first + 1) * PMA_SEGMENT_SIZE;
+  int * keys = malloc(sizeof(int) * slots);
+  void ** values = (pma -> values == NULL) ? NULL : malloc(sizeof(void * ) * slots);
+  long n = gatherKeys(pma, first, last, keys, values);
+  spreadKeys(pma, first, last, keys, values, n);
+  free(keys);
+  free(values);
+}
+
+// Moves every key into a new array of 'numSegments' segments.
+void resizePMA(ClosestPMA * pma, int numSegments) {
+  long n = pma -> count;
+  int * keys = malloc(sizeof(int) * (n > 0 ? n : 1));
+  void ** values = (pma -> values == NULL) ? NULL :
+    malloc(sizeof(void * ) * (n > 0 ? n : 1));
+  gatherKeys(pma, 0, pma -> numSegments - 1, keys, values);
+
+  long slots = (long) numSegments * PMA_SEGMENT_SIZE;
+  free(pma -> keys);
+  free(pma -> segmentCount);
+  free(pma -> index);
+  pma -> keys = malloc(sizeof(int) * slots);
+  if (pma -> values != NULL) {
+    free(pma -> values);
+    pma -> values = calloc(slots, sizeof(void * ));
+  }
+  pma -> segmentCount = calloc(numSegments, sizeof(int));
+  pma -> index = calloc(2 * numSegments, sizeof(PMASummary));
+  pma -> numSegments = numSegments;
+  spreadKeys(pma, 0, numSegments - 1, keys, values, n);
+  free(keys);
+  free(values);
+}
+
+/*
+ * Makes room in the full segment 's': walks up the index to the smallest
+ * window whose density, counting the new key, is within its bound (from 1
+ * at the leaves down to PMA_ROOT_DENSITY at the root) and spreads it out,
+ * or doubles the array if even the root is too dense. The window must also
+ * have at least one free slot per segment, so that 's' ends up non-full.
+ */
+void makeRoom(ClosestPMA * pma, int s) {
+  int height = 0;
+  while ((1 << height) < pma -> numSegments) {
+    height++;
+  }
+
+  long node = pma -> numSegments + s;
+  int segments = 1;
+  int depth = height;
+  while (node > 1) {
+    node /= 2;
+    segments *= 2;
+    depth--;
+    long slots = (long) segments * PMA_SEGMENT_SIZE;
+    long count = pma -> index[node].count;
+    double bound = PMA_ROOT_DENSITY +
+      (1 - PMA_ROOT_DENSITY) * depth / height;
+    if (count + 1 <= bound * slots && count <= slots - segments) {
+      int first = node * segments - pma -> numSegments;
+      rebalanceWindow(pma, first, first + segments - 1);
+      return;
+    }
+  }
+  resizePMA(pma, 2 * pma -> numSegments);
+}
+
+/*
+ * Returns the summary of the keys in [lo, hi] below index node 'node'.
+ */
+PMASummary rangeSummary(ClosestPMA * pma, long node, int lo, int hi) {
+  PMASummary * s = & pma -> index[node];
+  if (s -> count == 0 || s -> max < lo || s -> min > hi) {
+    PMASummary empty = { 0 };
+    return empty;
+  }
+  if (lo <= s -> min && s -> max <= hi) {
+    return * s;
+  }
+  if (node >= pma -> numSegments) {
+    // Partially covered segment: summarize the keys in range directly.
+    int segment = node - pma -> numSegments;
+    int * keys = & pma -> keys[(long) segment * PMA_SEGMENT_SIZE];
+    int n = pma -> segmentCount[segment];
+    int first = lowerBound(keys, n, lo);
+    int last = first;
+    while (last < n && keys[last] <= hi) {
+      last++;
+    }
+    return summarizeKeys(keys + first, last - first);
+  }
+  return mergeSummaries(rangeSummary(pma, 2 * node, lo, hi),
+    rangeSummary(pma, 2 * node + 1, lo, hi));
+}
+
+/*************************************************************************
+ ** PMA operations
+ *************************************************************************/
+
+ClosestPMA * newPMA() {
+  ClosestPMA * pma = malloc(sizeof(ClosestPMA));
+  pma -> keys = malloc(sizeof(int) * PMA_SEGMENT_SIZE);
+  pma -> values = NULL;
+  pma -> segmentCount = calloc(1, sizeof(int));
+  pma -> numSegments = 1;
+  pma -> count = 0;
+  pma -> index = calloc(2, sizeof(PMASummary));
+  return pma;
+}
+
+bool pmaSearch(ClosestPMA * pma, int key, void ** value) {
+  int s = findSegment(pma, key);
+  long start = (long) s * PMA_SEGMENT_SIZE;
+  int n = pma -> segmentCount[s];
+  int i = lowerBound(pma -> keys + start, n, key);
+  if (i == n || pma -> keys[start + i] != key) {
+    return false;
+  }
+  if (value != NULL) {
+    * value = (pma -> values == NULL) ? NULL : pma -> values[start + i];
+  }
+  return true;
+}
+
+void pmaInsert(ClosestPMA * pma, int key, void * value) {
+  int s = findSegment(pma, key);
+  long start = (long) s * PMA_SEGMENT_SIZE;
+  int n = pma -> segmentCount[s];
+  int i = lowerBound(pma -> keys + start, n, key);
+
+  if (value != NULL && pma -> values == NULL) {
+    pma -> values = calloc((long) pma -> numSegments * PMA_SEGMENT_SIZE,
+      sizeof(void * ));
+  }
+  if (i < n && pma -> keys[start + i] == key) {
+    if (pma -> values != NULL) {
+      pma -> values[start + i] = value;
+    }
+    return;
+  }
+
+  if (n == PMA_SEGMENT_SIZE) {
+    makeRoom(pma, s);
+    s = findSegment(pma, key);
+    start = (long) s * PMA_SEGMENT_SIZE;
+    n = pma -> segmentCount[s];
+    i = lowerBound(pma -> keys + start, n, key);
+  }
+
+  memmove(pma -> keys + start + i + 1, pma -> keys + start + i,
+    sizeof(int) * (n - i));
+  pma -> keys[start + i] = key;
+  if (pma -> values != NULL) {
+    memmove(pma -> values + start + i + 1, pma -> values + start + i,
+      sizeof(void * ) * (n - i));
+    pma -> values[start + i] = value;
+  }
+  pma -> segmentCount[s]++;
+  pma -> count++;
+  refreshIndex(pma, s, s);
+}
+
+void pmaDelete(ClosestPMA * pma, int key) {
+  int s = findSegment(pma, key);
+  long start = (long) s * PMA_SEGMENT_SIZE;
+  int n = pma -> segmentCount[s];
+  int i = lowerBound(pma -> keys + start, n, key);
+  if (i == n || pma -> keys[start + i] != key) {
+    return;
+  }
+
+  memmove(pma -> keys + start + i, pma -> keys + start + i + 1,
+    sizeof(int) * (n - i - 1));
+  if (pma -> values != NULL) {
+    memmove(pma -> values + start + i, pma -> values + start + i + 1,
+      sizeof(void * ) * (n - i - 1));
+  }
+  pma -> segmentCount[s]--;
+  pma -> count--;
+  refreshIndex(pma, s, s);
+
+  // Segments are not merged; instead the array shrinks once it is sparse,
+  // which keeps scans within a constant factor of the key count.
+  if (pma -> numSegments > 1 && pma -> count <
+    PMA_MIN_DENSITY * pma -> numSegments * PMA_SEGMENT_SIZE) {
+    resizePMA(pma, pma -> numSegments / 2);
+  }
+}
+
+bool pmaGetClosestPair(ClosestPMA * pma, pair * result) {
+  if (pma -> index[1].count < 2) {
+    return false;
+  }
+  * result = pma -> index[1].closest;
+  return true;
+}
+
+bool pmaClosestPairInRange(ClosestPMA * pma, int lo, int hi, pair * result) {
+  PMASummary s = rangeSummary(pma, 1, lo, hi);
+  if (s.count < 2) {
+    return false;
+  }
+  * result = s.closest;
+  return true;
+}
+
+int pmaRangeScan(ClosestPMA * pma, int lo, int hi, int keys[], int maxKeys) {
+  int copied = 0;
+  int s = findSegment(pma, lo);
+  long start = (long) s * PMA_SEGMENT_SIZE;
+  int i = lowerBound(pma -> keys + start, pma -> segmentCount[s], lo);
+  for (; s < pma -> numSegments; s++, i = 0) {
+    int * segment = pma -> keys + (long) s * PMA_SEGMENT_SIZE;
+    int n = pma -> segmentCount[s];
+    for (; i < n; i++) {
+      if (segment[i] > hi || copied == maxKeys) {
+        return copied;
+      }
+      keys[copied++] = segment[i];
+    }
+  }
+  return copied;
+}
+
+void deletePMA(ClosestPMA * pma) {
+  free(pma -> keys);
+  free(pma -> values);
+  free(pma -> segmentCount);
+  free(pma -> index);
+  free(pma);
+}
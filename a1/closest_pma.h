@@ -0,0 +1,89 @@
+/*
+ *  Header file for the packed-memory-array closest-pair backend.
+ *
+ *  Keys are kept in one sorted array split into segments of
+ *  PMA_SEGMENT_SIZE slots; each segment is packed to its left and the rest
+ *  of it is left free for future inserts. When a segment fills up, the
+ *  smallest enclosing window of segments that is sparse enough is spread
+ *  out evenly (amortized O(log^2 n) moves per update); when the whole
+ *  array is too dense it doubles.
+ *
+ *  On top of the segments sits a static index: a complete binary tree
+ *  stored in an array (root at index 1) whose nodes hold the number of
+ *  keys, min, max and closest pair of their segments. It routes searches
+ *  and answers closest-pair queries, over the whole set or a key range.
+ *  Range scans read the key array sequentially.
+ */
+
+#include "closest_AVL_tree.h"
+
+#ifndef __closest_pma_header
+#define __closest_pma_header
+
+#define PMA_SEGMENT_SIZE 64
+
+typedef struct pma_summary
+{
+  int count;        // number of keys below this index node
+  int min;          // smallest key (if count > 0)
+  int max;          // largest key (if count > 0)
+  pair closest;     // closest pair (if count > 1)
+} PMASummary;
+
+typedef struct closest_pma
+{
+  int* keys;            // numSegments * PMA_SEGMENT_SIZE slots
+  void** values;        // parallel to 'keys'; NULL until a value is stored
+  int* segmentCount;    // number of keys packed at the start of each segment
+  int numSegments;      // a power of 2
+  long count;           // number of keys stored
+  PMASummary* index;    // 2 * numSegments nodes, root at 1, leaves last
+} ClosestPMA;
+
+/*
+ * Returns a new empty packed memory array.
+ */
+ClosestPMA* newPMA();
+
+/*
+ * Returns true iff 'key' is in 'pma'. If so and 'value' is not NULL, the
+ * value associated with 'key' is stored in 'value'. O(log n).
+ */
+bool pmaSearch(ClosestPMA* pma, int key, void** value);
+
+/*
+ * Inserts 'key'/'value' into 'pma', updating the value if 'key' is already
+ * present.
+ */
+void pmaInsert(ClosestPMA* pma, int key, void* value);
+
+/*
+ * Deletes 'key' from 'pma'. Has no effect if 'key' is not in 'pma'.
+ */
+void pmaDelete(ClosestPMA* pma, int key);
+
+/*
+ * Stores the closest pair of keys in 'pma' in 'result' and returns true,
+ * or returns false if 'pma' has less than 2 keys. O(1).
+ */
+bool pmaGetClosestPair(ClosestPMA* pma, pair* result);
+
+/*
+ * Stores the closest pair among the keys in [lo, hi] in 'result' and
+ * returns true, or returns false if there are less than 2 such keys.
+ * O(log n) index nodes plus at most two partially covered segments.
+ */
+bool pmaClosestPairInRange(ClosestPMA* pma, int lo, int hi, pair* result);
+
+/*
+ * Copies the keys in [lo, hi], in increasing order, to 'keys' (at most
+ * 'maxKeys' of them). Returns the number of keys copied.
+ */
+int pmaRangeScan(ClosestPMA* pma, int lo, int hi, int keys[], int maxKeys);
+
+/*
+ * Frees all memory allocated for 'pma'.
+ */
+void deletePMA(ClosestPMA* pma);
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ *  Bounded-universe closest-pair trie implementation.
+ */
+
+#include <limits.h>
+
+#include "closest_trie.h"
+
+#define TRIE_MASK (TRIE_FANOUT - 1)
+#define TRIE_MAX_LEVELS 6
+
+// Inner node: bit i of 'bits' is set iff 'children[i]' is non-empty.
+typedef struct trie_inner {
+  uint64_t bits;
+  void * children[TRIE_FANOUT];
+} TrieInner;
+
+// Leaf node: bit i of 'bits' is set iff key (prefix << 6 | i) is present.
+typedef struct trie_leaf {
+  uint64_t bits;
+  void ** values; // allocated on the first non-NULL value
+} TrieLeaf;
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+// Returns the digit of 'offset' consumed at 'level'.
+int trieDigit(ClosestTrie * trie, uint64_t offset, int level) {
+  return (offset >> (TRIE_FANOUT_BITS * (trie -> levels - 1 - level))) &
+    TRIE_MASK;
+}
+
+// Returns true iff 'key' is in the universe; stores its offset in 'offset'.
+bool trieOffset(ClosestTrie * trie, int key, uint64_t * offset) {
+  if (key < trie -> base) {
+    return false;
+  }
+  * offset = (uint64_t)((long long) key - trie -> base);
+  return ( * offset >> trie -> universeBits) == 0;
+}
+
+int trieKey(ClosestTrie * trie, uint64_t offset) {
+  return (int)(trie -> base + (long long) offset);
+}
+
+// Bits of 'bits' strictly below / above slot 'digit'.
+uint64_t bitsBelow(uint64_t bits, int digit) {
+  return bits & ((1ULL << digit) - 1);
+}
+
+uint64_t bitsAbove(uint64_t bits, int digit) {
+  return (digit == TRIE_MASK) ? 0 : bits & (~0ULL << (digit + 1));
+}
+
+int highestBit(uint64_t bits) {
+  return 63 - __builtin_clzll(bits);
+}
+
+int lowestBit(uint64_t bits) {
+  return __builtin_ctzll(bits);
+}
+
+/*
+ * Completes 'prefix' (the digits of levels 0..level-1 followed by the digit
+ * of 'node' at 'level') with the largest (or smallest) key stored below
+ * 'node', which must be non-empty.
+ */
+uint64_t descendToExtreme(ClosestTrie * trie, void * node, int level,
+  uint64_t prefix, bool largest) {
+  while (level < trie -> levels - 1) {
+    uint64_t bits = ((TrieInner * ) node) -> bits;
+    int digit = largest ? highestBit(bits) : lowestBit(bits);
+    node = ((TrieInner * ) node) -> children[digit];
+    prefix = (prefix << TRIE_FANOUT_BITS) | digit;
+    level++;
+  }
+  uint64_t bits = ((TrieLeaf * ) node) -> bits;
+  int digit = largest ? highestBit(bits) : lowestBit(bits);
+  return (prefix << TRIE_FANOUT_BITS) | digit;
+}
+
+/*
+ * Finds the closest key to 'offset' strictly below it (or above it if
+ * 'above'). Walks down as far as the path of 'offset' exists, then back up
+ * to the first node holding a slot on the wanted side, then down to the
+ * extreme key under that slot: at most 2 * levels steps.
+ */
+bool trieNeighbour(ClosestTrie * trie, uint64_t offset, bool above,
+  uint64_t * result) {
+  void * path[TRIE_MAX_LEVELS];
+  int reached = -1;
+  void * node = trie -> root;
+  while (node != NULL) {
+    path[++reached] = node;
+    if (reached == trie -> levels - 1) {
+      break;
+    }
+    node = ((TrieInner * ) node) -> children[trieDigit(trie, offset, reached)];
+  }
+
+  for (int level = reached; level >= 0; level--) {
+    int digit = trieDigit(trie, offset, level);
+    uint64_t bits = * (uint64_t * ) path[level];
+    bits = above ? bitsAbove(bits, digit) : bitsBelow(bits, digit);
+    if (bits == 0) {
+      continue;
+    }
+    int next = above ? lowestBit(bits) : highestBit(bits);
+    int shift = TRIE_FANOUT_BITS * (trie -> levels - level);
+    uint64_t prefix = (shift >= 64) ? 0 : offset >> shift;
+    prefix = (prefix << TRIE_FANOUT_BITS) | next;
+    if (level == trie -> levels - 1) {
+      * result = prefix;
+    } else {
+      void * child = ((TrieInner * ) path[level]) -> children[next];
+      * result = descendToExtreme(trie, child, level + 1, prefix, !above);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Returns the leaf holding 'offset', or NULL.
+TrieLeaf * findLeaf(ClosestTrie * trie, uint64_t offset) {
+  void * node = trie -> root;
+  for (int level = 0; node != NULL && level < trie -> levels - 1; level++) {
+    node = ((TrieInner * ) node) -> children[trieDigit(trie, offset, level)];
+  }
+  return node;
+}
+
+void freeTrieNode(ClosestTrie * trie, void * node, int level) {
+  if (node == NULL) {
+    return;
+  }
+  if (level == trie -> levels - 1) {
+    free(((TrieLeaf * ) node) -> values);
+  } else {
+    uint64_t bits = ((TrieInner * ) node) -> bits;
+    while (bits != 0) {
+      int digit = lowestBit(bits);
+      freeTrieNode(trie, ((TrieInner * ) node) -> children[digit], level + 1);
+      bits &= bits - 1;
+    }
+  }
+  free(node);
+}
+
+/*************************************************************************
+ ** Gap index
+ *************************************************************************/
+
+void gapSwap(TrieGap * a, TrieGap * b) {
+  TrieGap temp = * a;
+  * a = * b;
+  * b = temp;
+}
+
+void gapPush(ClosestTrie * trie, uint64_t gap, uint32_t lower) {
+  if (trie -> numGaps + 1 >= trie -> gapCapacity) {
+    trie -> gapCapacity *= 2;
+    trie -> gaps = realloc(trie -> gaps, sizeof(TrieGap) * trie -> gapCapacity);
+  }
+  long i = ++trie -> numGaps;
+  trie -> gaps[i].gap = gap;
+  trie -> gaps[i].lower = lower;
+  while (i > 1 && trie -> gaps[i / 2].gap > trie -> gaps[i].gap) {
+    gapSwap( & trie -> gaps[i / 2], & trie -> gaps[i]);
+    i /= 2;
+  }
+}
+
+void gapPop(ClosestTrie * trie) {
+  TrieGap * gaps = trie -> gaps;
+  gaps[1] = gaps[trie -> numGaps--];
+  long i = 1;
+  while (2 * i <= trie -> numGaps) {
+    long child = 2 * i;
+    if (child + 1 <= trie -> numGaps && gaps[child + 1].gap < gaps[child].gap) {
+      child++;
+    }
+    if (gaps[i].gap <= gaps[child].gap) {
+      break;
+    }
+    gapSwap( & gaps[i], & gaps[child]);
+    i = child;
+  }
+}
+
+// An entry is current iff both its keys are present and adjacent.
+bool gapIsCurrent(ClosestTrie * trie, TrieGap * entry) {
+  TrieLeaf * leaf = findLeaf(trie, entry -> lower);
+  if (leaf == NULL || !(leaf -> bits >> (entry -> lower & TRIE_MASK) & 1)) {
+    return false;
+  }
+  uint64_t next;
+  return trieNeighbour(trie, entry -> lower, true, & next) &&
+    next - entry -> lower == entry -> gap;
+}
+
+/*
+ * Rebuilds the gap index from the adjacent pairs of the trie, once stale
+ * entries outnumber current ones. Amortized O(1) per update.
+ */
+void rebuildGaps(ClosestTrie * trie) {
+  trie -> numGaps = 0;
+  if (trie -> root == NULL) {
+    return;
+  }
+  uint64_t current = descendToExtreme(trie, trie -> root, 0, 0, false);
+  uint64_t next;
+  while (trieNeighbour(trie, current, true, & next)) {
+    gapPush(trie, next - current, (uint32_t) current);
+    current = next;
+  }
+}
+
+void gapsChanged(ClosestTrie * trie) {
+  if (trie -> numGaps > 2 * trie -> count + 16) {
+    rebuildGaps(trie);
+  }
+}
+
+/*************************************************************************
+ ** Trie operations
+ *************************************************************************/
+
+ClosestTrie * newClosestTrie(int minKey, int universeBits) {
+  if (universeBits < 1 || universeBits > 32 ||
+    (long long) minKey + ((1LL << universeBits) - 1) > INT_MAX) {
+    return NULL;
+  }
+  ClosestTrie * trie = malloc(sizeof(ClosestTrie));
+  trie -> base = minKey;
+  trie -> universeBits = universeBits;
+  trie -> levels = (universeBits + TRIE_FANOUT_BITS - 1) / TRIE_FANOUT_BITS;
+  trie -> root = NULL;
+  trie -> count = 0;
+  trie -> gapCapacity = 64;
+  trie -> gaps = malloc(sizeof(TrieGap) * trie -> gapCapacity);
+  trie -> numGaps = 0;
+  return trie;
+}
+
+bool trieSearch(ClosestTrie * trie, int key, void ** value) {
+  uint64_t offset;
+  if (!trieOffset(trie, key, & offset)) {
+    return false;
+  }
+  TrieLeaf * leaf = findLeaf(trie, offset);
+  int digit = offset & TRIE_MASK;
+  if (leaf == NULL || !(leaf -> bits >> digit & 1)) {
+    return false;
+  }
+  if (value != NULL) {
+    * value = (leaf -> values == NULL) ? NULL : leaf -> values[digit];
+  }
+  return true;
+}
+
+bool trieInsert(ClosestTrie * trie, int key, void * value) {
+  uint64_t offset;
+  if (!trieOffset(trie, key, & offset)) {
+    return false;
+  }
+
+  void ** link = & trie -> root;
+  for (int level = 0; level < trie -> levels - 1; level++) {
+    if ( * link == NULL) {
+      * link = calloc(1, sizeof(TrieInner));
+    }
+    TrieInner * inner = * link;
+    int digit = trieDigit(trie, offset, level);
+    inner -> bits |= 1ULL << digit;
+    link = & inner -> children[digit];
+  }
+  if ( * link == NULL) {
+    * link = calloc(1, sizeof(TrieLeaf));
+  }
+  TrieLeaf * leaf = * link;
+  int digit = offset & TRIE_MASK;
+  bool present = leaf -> bits >> digit & 1;
+  leaf -> bits |= 1ULL << digit;
+  if (value != NULL && leaf -> values == NULL) {
+    leaf -> values = calloc(TRIE_FANOUT, sizeof(void * ));
+  }
+  if (leaf -> values != NULL) {
+    leaf -> values[digit] = value;
+  }
+  if (present) {
+    return true;
+  }
+
+  // Only the gaps to the new key's neighbours can become the closest pair;
+  // the gap between the neighbours themselves goes stale.
+  trie -> count++;
+  uint64_t neighbour;
+  if (trieNeighbour(trie, offset, false, & neighbour)) {
+    gapPush(trie, offset - neighbour, (uint32_t) neighbour);
+  }
+  if (trieNeighbour(trie, offset, true, & neighbour)) {
+    gapPush(trie, neighbour - offset, (uint32_t) offset);
+  }
+  gapsChanged(trie);
+  return true;
+}
+
+void trieDelete(ClosestTrie * trie, int key) {
+  uint64_t offset;
+  if (!trieOffset(trie, key, & offset)) {
+    return;
+  }
+
+  void ** links[TRIE_MAX_LEVELS];
+  void ** link = & trie -> root;
+  for (int level = 0; level < trie -> levels; level++) {
+    if ( * link == NULL) {
+      return;
+    }
+    links[level] = link;
+    if (level < trie -> levels - 1) {
+      link = & ((TrieInner * ) * link) -> children[trieDigit(trie, offset, level)];
+    }
+  }
+  TrieLeaf * leaf = * links[trie -> levels - 1];
+  int digit = offset & TRIE_MASK;
+  if (!(leaf -> bits >> digit & 1)) {
+    return;
+  }
+
+  // Clear the key, then free every node that became empty on the way up.
+  leaf -> bits &= ~(1ULL << digit);
+  if (leaf -> values != NULL) {
+    leaf -> values[digit] = NULL;
+  }
+  for (int level = trie -> levels - 1; level >= 0; level--) {
+    void * node = * links[level];
+    if ( * (uint64_t * ) node != 0) {
+      break;
+    }
+    if (level == trie -> levels - 1) {
+      free(((TrieLeaf * ) node) -> values);
+    }
+    free(node);
+    * links[level] = NULL;
+    if (level > 0) {
+      TrieInner * parent = * links[level - 1];
+      parent -> bits &= ~(1ULL << trieDigit(trie, offset, level - 1));
+    }
+  }
+  trie -> count--;
+
+  // The neighbours of the deleted key are now adjacent.
+  uint64_t lower, upper;
+  if (trieNeighbour(trie, offset, false, & lower) &&
+    trieNeighbour(trie, offset, true, & upper)) {
+    gapPush(trie, upper - lower, (uint32_t) lower);
+  }
+  gapsChanged(trie);
+}
+
+bool triePredecessor(ClosestTrie * trie, int key, int * result) {
+  uint64_t offset, found;
+  if (key < trie -> base) {
+    return false;
+  }
+  if (!trieOffset(trie, key, & offset)) {
+    // Everything in the trie is below 'key'.
+    if (trie -> root == NULL) {
+      return false;
+    }
+    * result = trieKey(trie, descendToExtreme(trie, trie -> root, 0, 0, true));
+    return true;
+  }
+  if (!trieNeighbour(trie, offset, false, & found)) {
+    return false;
+  }
+  * result = trieKey(trie, found);
+  return true;
+}
+
+bool trieSuccessor(ClosestTrie * trie, int key, int * result) {
+  uint64_t offset, found;
+  if (key < trie -> base) {
+    // Everything in the trie is above 'key'.
+    if (trie -> root == NULL) {
+      return false;
+    }
+    * result = trieKey(trie, descendToExtreme(trie, trie -> root, 0, 0, false));
+    return true;
+  }
+  if (!trieOffset(trie, key, & offset) ||
+    !trieNeighbour(trie, offset, true, & found)) {
+    return false;
+  }
+  * result = trieKey(trie, found);
+  return true;
+}
+
+bool trieGetClosestPair(ClosestTrie * trie, pair * result) {
+  while (trie -> numGaps > 0 && !gapIsCurrent(trie, & trie -> gaps[1])) {
+    gapPop(trie);
+  }
+  if (trie -> numGaps == 0) {
+    return false;
+  }
+  result -> lower = trieKey(trie, trie -> gaps[1].lower);
+  result -> upper = trieKey(trie, trie -> gaps[1].lower + trie -> gaps[1].gap);
+  return true;
+}
+
+void deleteClosestTrie(ClosestTrie * trie) {
+  freeTrieNode(trie, trie -> root, 0);
+  free(trie -> gaps);
+  free(trie);
+}
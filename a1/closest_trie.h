@@ -0,0 +1,88 @@
+/*
+ *  Header file for the bounded-universe closest-pair trie.
+ *
+ *  Offers the closest-AVL operations (search, insert, delete, closest pair)
+ *  plus predecessor/successor for keys drawn from a known range of at most
+ *  2^32 values. Keys are stored in a 64-ary bitmap trie, van Emde Boas
+ *  style: each level consumes 6 bits of the key, and the highest/lowest
+ *  occupied slot of a node is found with a single bit scan, so
+ *  predecessor/successor take at most ceil(bits / 6) steps down and back up
+ *  (6 for 32-bit keys), independent of the number of keys.
+ *
+ *  The closest pair is kept in a gap index: a min-heap of adjacent-key gaps
+ *  filled by comparing each new key only with its neighbours. Entries made
+ *  stale by later updates are dropped when they reach the top.
+ */
+
+#include <stdint.h>
+
+#include "closest_AVL_tree.h"
+
+#ifndef __closest_trie_header
+#define __closest_trie_header
+
+#define TRIE_FANOUT_BITS 6
+#define TRIE_FANOUT (1 << TRIE_FANOUT_BITS)
+
+typedef struct trie_gap
+{
+  uint64_t gap;     // upper - lower
+  uint32_t lower;   // lower key of the pair, as an offset from 'base'
+} TrieGap;
+
+typedef struct closest_trie
+{
+  int base;           // smallest key of the universe
+  int universeBits;   // keys are base .. base + 2^universeBits - 1
+  int levels;         // number of trie levels, the last one holds leaves
+  void* root;         // root node, or NULL if the trie is empty
+  long count;         // number of keys stored
+  TrieGap* gaps;      // gap index: min-heap on 'gap', 1-based
+  long numGaps;       // number of entries in 'gaps' (stale ones included)
+  long gapCapacity;   // number of entries 'gaps' can hold
+} ClosestTrie;
+
+/*
+ * Returns a new empty trie for keys in [minKey, minKey + 2^universeBits),
+ * or NULL if 'universeBits' is not in 1..32 or the range overflows int.
+ */
+ClosestTrie* newClosestTrie(int minKey, int universeBits);
+
+/*
+ * Returns true iff 'key' is in 'trie'. If so and 'value' is not NULL, the
+ * value associated with 'key' is stored in 'value'.
+ */
+bool trieSearch(ClosestTrie* trie, int key, void** value);
+
+/*
+ * Inserts 'key'/'value' into 'trie', updating the value if 'key' is already
+ * present. Returns false (and does nothing) if 'key' is outside the
+ * universe of 'trie'.
+ */
+bool trieInsert(ClosestTrie* trie, int key, void* value);
+
+/*
+ * Deletes 'key' from 'trie'. Has no effect if 'key' is not in 'trie'.
+ */
+void trieDelete(ClosestTrie* trie, int key);
+
+/*
+ * Stores in 'result' the largest key smaller than 'key' (triePredecessor)
+ * or the smallest key larger than 'key' (trieSuccessor) and returns true,
+ * or returns false if there is no such key.
+ */
+bool triePredecessor(ClosestTrie* trie, int key, int* result);
+bool trieSuccessor(ClosestTrie* trie, int key, int* result);
+
+/*
+ * Stores the closest pair of keys in 'trie' in 'result' and returns true,
+ * or returns false if 'trie' has less than 2 keys. O(1) amortized.
+ */
+bool trieGetClosestPair(ClosestTrie* trie, pair* result);
+
+/*
+ * Frees all memory allocated for 'trie'.
+ */
+void deleteClosestTrie(ClosestTrie* trie);
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ *  Compact closest-AVL tree implementation: nodes in one arena, linked by
+ *  32-bit indices. Mirrors closest_AVL_tree.c operation for operation.
+ */
+
+#include "compact_AVL_tree.h"
+
+/*************************************************************************
+ ** Arena management
+ *************************************************************************/
+
+compact_AVL_Arena * newCompactArena(uint32_t capacity) {
+  // one extra slot for the sentinel
+  if (capacity < 1) {
+    capacity = 1;
+  }
+  if (capacity < UINT32_MAX) {
+    capacity += 1;
+  }
+
+  compact_AVL_Arena * arena = malloc(sizeof(compact_AVL_Arena));
+  compact_AVL_Node * nodes = malloc(sizeof(compact_AVL_Node) * (size_t) capacity);
+  if (arena == NULL || nodes == NULL) {
+    free(arena);
+    free(nodes);
+    return NULL;
+  }
+  arena -> nodes = nodes;
+  arena -> values = NULL;
+  arena -> size = 1;
+  arena -> capacity = capacity;
+  arena -> freeList = COMPACT_NIL;
+
+  // The sentinel looks like an empty tree: height 0, no children.
+  compact_AVL_Node * nil = & arena -> nodes[COMPACT_NIL];
+  nil -> key = 0;
+  nil -> min = INT_MAX;
+  nil -> max = INT_MIN;
+  nil -> lower = 0;
+  nil -> upper = 0;
+  nil -> left = COMPACT_NIL;
+  nil -> right = COMPACT_NIL;
+  nil -> height = 0;
+  return arena;
+}
+
+void deleteCompactArena(compact_AVL_Arena * arena) {
+  free(arena -> nodes);
+  free(arena -> values);
+  free(arena);
+}
+
+/*
+ * Makes sure at least one slot can be handed out without reallocating, so
+ * that the recursive operations below never see the node array move.
+ * Returns false if the arena cannot grow: every 32-bit index is taken, or
+ * out of memory. The arena is still usable then.
+ */
+bool compactReserve(compact_AVL_Arena * arena) {
+  if (arena -> freeList != COMPACT_NIL || arena -> size < arena -> capacity) {
+    return true;
+  }
+  if (arena -> capacity == UINT32_MAX) {
+    return false;
+  }
+  // Doubling must not wrap around to a smaller capacity.
+  uint32_t capacity = (arena -> capacity > UINT32_MAX / 2) ? UINT32_MAX :
+    2 * arena -> capacity;
+  compact_AVL_Node * nodes = realloc(arena -> nodes,
+    sizeof(compact_AVL_Node) * (size_t) capacity);
+  if (nodes == NULL) {
+    return false;
+  }
+  arena -> nodes = nodes;
+  if (arena -> values != NULL) {
+    void ** values = realloc(arena -> values, sizeof(void * ) * (size_t) capacity);
+    if (values == NULL) {
+      return false;
+    }
+    arena -> values = values;
+  }
+  arena -> capacity = capacity;
+  return true;
+}
+
+/*
+ * Sets the value of node 'index', allocating the value array the first
+ * time a non-NULL value shows up.
+ */
+void compactSetValue(compact_AVL_Arena * arena, uint32_t index, void * value) {
+  if (arena -> values == NULL) {
+    if (value == NULL) {
+      return;
+    }
+    arena -> values = calloc(arena -> capacity, sizeof(void * ));
+  }
+  arena -> values[index] = value;
+}
+
+/*
+ * Takes a slot from the arena and turns it into a leaf holding 'key'.
+ * Precondition: compactReserve was called since the last allocation.
+ */
+uint32_t compactCreateNode(compact_AVL_Arena * arena, int key, void * value) {
+  uint32_t index;
+  if (arena -> freeList != COMPACT_NIL) {
+    index = arena -> freeList;
+    arena -> freeList = arena -> nodes[index].left;
+  } else {
+    index = arena -> size++;
+  }
+
+  compact_AVL_Node * node = & arena -> nodes[index];
+  node -> key = key;
+  node -> min = key;
+  node -> max = key;
+  node -> lower = 0;
+  node -> upper = 0;
+  node -> left = COMPACT_NIL;
+  node -> right = COMPACT_NIL;
+  node -> height = 1;
+  if (arena -> values != NULL) {
+    arena -> values[index] = NULL;
+  }
+  compactSetValue(arena, index, value);
+  return index;
+}
+
+// Puts slot 'index' back on the free list.
+void compactFreeNode(compact_AVL_Arena * arena, uint32_t index) {
+  arena -> nodes[index].left = arena -> freeList;
+  arena -> freeList = index;
+}
+
+/*************************************************************************
+ ** Augmentation and rotations
+ *************************************************************************/
+
+/*
+ * Recomputes height, min, max and the closest pair of node 'index' from
+ * its children, exactly like updateAll in closest_AVL_tree.c.
+ */
+void compactUpdate(compact_AVL_Arena * arena, uint32_t index) {
+  compact_AVL_Node * node = & arena -> nodes[index];
+  compact_AVL_Node * left = & arena -> nodes[node -> left];
+  compact_AVL_Node * right = & arena -> nodes[node -> right];
+
+  node -> height = (left -> height > right -> height ?
+    left -> height : right -> height) + 1;
+  node -> min = (node -> left == COMPACT_NIL) ? node -> key : left -> min;
+  node -> max = (node -> right == COMPACT_NIL) ? node -> key : right -> max;
+
+  // Candidates: the children's own pairs, and the pairs that straddle
+  // this node's key. Gaps are compared as long long so they cannot wrap.
+  long long best = LLONG_MAX;
+  if (node -> left != COMPACT_NIL) {
+    if (left -> height > 1) {
+      best = (long long) left -> upper - left -> lower;
+      node -> lower = left -> lower;
+      node -> upper = left -> upper;
+    }
+    if ((long long) node -> key - left -> max < best) {
+      best = (long long) node -> key - left -> max;
+      node -> lower = left -> max;
+      node -> upper = node -> key;
+    }
+  }
+  if (node -> right != COMPACT_NIL) {
+    // On the right, a tie goes to the right child's own pair over the
+    // straddling one; the left side wins ties with the right side.
+    long long gap = (long long) right -> min - node -> key;
+    int lower = node -> key;
+    int upper = right -> min;
+    if (right -> height > 1 &&
+      (long long) right -> upper - right -> lower <= gap) {
+      gap = (long long) right -> upper - right -> lower;
+      lower = right -> lower;
+      upper = right -> upper;
+    }
+    if (gap < best) {
+      node -> lower = lower;
+      node -> upper = upper;
+    }
+  }
+}
+
+int compactBalanceFactor(compact_AVL_Arena * arena, uint32_t index) {
+  compact_AVL_Node * node = & arena -> nodes[index];
+  return arena -> nodes[node -> left].height -
+    arena -> nodes[node -> right].height;
+}
+
+// single rotations: right/clockwise
+uint32_t compactRightRotation(compact_AVL_Arena * arena, uint32_t v) {
+  uint32_t x = arena -> nodes[v].left;
+  arena -> nodes[v].left = arena -> nodes[x].right;
+  arena -> nodes[x].right = v;
+
+  compactUpdate(arena, v);
+  compactUpdate(arena, x);
+  return x;
+}
+
+// single rotations: left/counter-clockwise
+uint32_t compactLeftRotation(compact_AVL_Arena * arena, uint32_t v) {
+  uint32_t x = arena -> nodes[v].right;
+  arena -> nodes[v].right = arena -> nodes[x].left;
+  arena -> nodes[x].left = v;
+
+  compactUpdate(arena, v);
+  compactUpdate(arena, x);
+  return x;
+}
+
+/*
+ * Rebalances node 'index' if needed and returns the root of the
+ * rebalanced subtree; same case analysis as rebalance().
+ */
+uint32_t compactRebalance(compact_AVL_Arena * arena, uint32_t index) {
+  compact_AVL_Node * nodes = arena -> nodes;
+  int balance = compactBalanceFactor(arena, index);
+  if (balance > 1) {
+    uint32_t left = nodes[index].left;
+    if (nodes[nodes[left].left].height < nodes[nodes[left].right].height) {
+      nodes[index].left = compactLeftRotation(arena, left);
+    }
+    index = compactRightRotation(arena, index);
+  } else if (balance < -1) {
+    uint32_t right = nodes[index].right;
+    if (nodes[nodes[right].left].height > nodes[nodes[right].right].height) {
+      nodes[index].right = compactRightRotation(arena, right);
+    }
+    index = compactLeftRotation(arena, index);
+  }
+  return index;
+}
+
+/*************************************************************************
+ ** Tree operations
+ *************************************************************************/
+
+uint32_t compactSearch(compact_AVL_Arena * arena, uint32_t root, int key) {
+  uint32_t index = root;
+  while (index != COMPACT_NIL && arena -> nodes[index].key != key) {
+    if (arena -> nodes[index].key < key) {
+      index = arena -> nodes[index].right;
+    } else {
+      index = arena -> nodes[index].left;
+    }
+  }
+  return index;
+}
+
+void * compactValue(compact_AVL_Arena * arena, uint32_t index) {
+  if (arena -> values == NULL) {
+    return NULL;
+  }
+  return arena -> values[index];
+}
+
+uint32_t compactInsert_(compact_AVL_Arena * arena, uint32_t index, int key,
+  void * value) {
+  if (index == COMPACT_NIL) {
+    return compactCreateNode(arena, key, value);
+  }
+
+  if (arena -> nodes[index].key > key) {
+    uint32_t left = compactInsert_(arena, arena -> nodes[index].left, key, value);
+    arena -> nodes[index].left = left;
+  } else if (arena -> nodes[index].key < key) {
+    uint32_t right = compactInsert_(arena, arena -> nodes[index].right, key, value);
+    arena -> nodes[index].right = right;
+  } else {
+    // If the target key is already present, update the value.
+    compactSetValue(arena, index, value);
+    return index;
+  }
+
+  compactUpdate(arena, index);
+  return compactRebalance(arena, index);
+}
+
+uint32_t compactInsert(compact_AVL_Arena * arena, uint32_t root, int key,
+  void * value) {
+  // Grow before descending: the recursion holds on to node indices only,
+  // but compactSetValue may still need the value array to be big enough.
+  if (!compactReserve(arena)) {
+    return root;
+  }
+  return compactInsert_(arena, root, key, value);
+}
+
+uint32_t compactDelete(compact_AVL_Arena * arena, uint32_t index, int key) {
+  if (index == COMPACT_NIL) {
+    return COMPACT_NIL;
+  }
+
+  compact_AVL_Node * node = & arena -> nodes[index];
+  if (node -> key < key) {
+    node -> right = compactDelete(arena, node -> right, key);
+  } else if (node -> key > key) {
+    node -> left = compactDelete(arena, node -> left, key);
+  } else if (node -> left == COMPACT_NIL || node -> right == COMPACT_NIL) {
+    // Zero or one child: the child (or nothing) takes this node's place.
+    uint32_t child = (node -> left == COMPACT_NIL) ? node -> right : node -> left;
+    compactFreeNode(arena, index);
+    return child;
+  } else {
+    // Two children: replace with the successor, then delete the successor.
+    uint32_t successor = node -> right;
+    while (arena -> nodes[successor].left != COMPACT_NIL) {
+      successor = arena -> nodes[successor].left;
+    }
+    node -> key = arena -> nodes[successor].key;
+    if (arena -> values != NULL) {
+      arena -> values[index] = arena -> values[successor];
+    }
+    node -> right = compactDelete(arena, node -> right, node -> key);
+  }
+
+  compactUpdate(arena, index);
+  return compactRebalance(arena, index);
+}
+
+bool compactGetClosestPair(compact_AVL_Arena * arena, uint32_t root,
+  pair * result) {
+  compact_AVL_Node * node = & arena -> nodes[root];
+  if (node -> height < 2) {
+    return false;
+  }
+  result -> lower = node -> lower;
+  result -> upper = node -> upper;
+  return true;
+}
+
+void compactDeleteTree(compact_AVL_Arena * arena, uint32_t root) {
+  if (root == COMPACT_NIL) {
+    return;
+  }
+  compactDeleteTree(arena, arena -> nodes[root].left);
+  compactDeleteTree(arena, arena -> nodes[root].right);
+  compactFreeNode(arena, root);
+}
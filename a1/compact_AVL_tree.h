@@ -0,0 +1,98 @@
+/*
+ *  Header file for the compact closest-AVL tree layout.
+ *
+ *  Same closest-pair AVL tree as closest_AVL_tree.h, but all nodes live in
+ *  one array (an arena) and refer to each other by 32-bit indices, with an
+ *  8-bit height and the closest pair stored inline. A node is 32 bytes
+ *  instead of ~80 (node + separately allocated pair + malloc overhead).
+ *  Several trees can share one arena; a tree is identified by the index of
+ *  its root, and every operation that changes a tree returns its new root.
+ */
+
+#include <stdint.h>
+
+#include "closest_AVL_tree.h"
+
+#ifndef __compact_AVL_tree_header
+#define __compact_AVL_tree_header
+
+#define COMPACT_NIL 0   // index of the sentinel standing in for NULL
+
+typedef struct compact_AVL_node
+{
+  int key;          // key stored in this node
+  int min;          // min value in tree rooted at this node
+  int max;          // max value in tree rooted at this node
+  int lower;        // closest pair in tree rooted at this node,
+  int upper;        //   only meaningful when height > 1
+  uint32_t left;    // index of this node's left child
+  uint32_t right;   // index of this node's right child
+  uint8_t height;   // height of tree rooted at this node
+} compact_AVL_Node;
+
+typedef struct compact_AVL_arena
+{
+  compact_AVL_Node* nodes;  // node storage; nodes[COMPACT_NIL] is the sentinel
+  void** values;            // values[i] belongs to nodes[i]; NULL until the
+                            //   first non-NULL value is inserted
+  uint32_t size;            // number of slots handed out, sentinel included
+  uint32_t capacity;        // number of slots allocated
+  uint32_t freeList;        // first recycled slot, chained through 'left'
+} compact_AVL_Arena;
+
+/*
+ * Returns a newly created arena with room for 'capacity' nodes, or NULL if
+ * out of memory. The arena grows by doubling when it runs out of room.
+ */
+compact_AVL_Arena* newCompactArena(uint32_t capacity);
+
+/*
+ * Frees the arena and every tree stored in it.
+ */
+void deleteCompactArena(compact_AVL_Arena* arena);
+
+/*
+ * Returns the index of the node with key 'key' in the tree rooted at
+ * 'root', or COMPACT_NIL if 'key' is not in the tree.
+ */
+uint32_t compactSearch(compact_AVL_Arena* arena, uint32_t root, int key);
+
+/*
+ * Returns the value stored at node 'index'.
+ */
+void* compactValue(compact_AVL_Arena* arena, uint32_t index);
+
+/*
+ * Makes sure the arena has room for one more node, growing it if needed.
+ * Returns false if it is full and cannot grow (out of memory, or out of
+ * 32-bit indices).
+ */
+bool compactReserve(compact_AVL_Arena* arena);
+
+/*
+ * Inserts 'key'/'value' into the tree rooted at 'root', updating the value
+ * if 'key' is already present. Returns the root of the resulting tree. If
+ * compactReserve fails, the tree is left unchanged; call it first to tell.
+ */
+uint32_t compactInsert(compact_AVL_Arena* arena, uint32_t root, int key,
+    void* value);
+
+/*
+ * Deletes 'key' from the tree rooted at 'root', if present, and returns
+ * the root of the resulting tree. Freed slots are reused by later inserts.
+ */
+uint32_t compactDelete(compact_AVL_Arena* arena, uint32_t root, int key);
+
+/*
+ * Stores the closest pair of keys of the tree rooted at 'root' in 'result'
+ * and returns true, or returns false if the tree has less than 2 keys.
+ */
+bool compactGetClosestPair(compact_AVL_Arena* arena, uint32_t root,
+    pair* result);
+
+/*
+ * Returns every node of the tree rooted at 'root' to the arena.
+ */
+void compactDeleteTree(compact_AVL_Arena* arena, uint32_t root);
+
+#endif
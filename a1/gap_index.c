@@ -0,0 +1,239 @@
+/*
+ *  Order-statistic index over adjacent gaps implementation.
+ */
+
+#include <math.h>
+
+#include "gap_index.h"
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+int gapHeight(GapNode * node) {
+  return (node == NULL) ? 0 : node -> height;
+}
+
+long gapSize(GapNode * node) {
+  return (node == NULL) ? 0 : node -> size;
+}
+
+void updateGapNode(GapNode * node) {
+  int left = gapHeight(node -> left);
+  int right = gapHeight(node -> right);
+  node -> height = 1 + ((left > right) ? left : right);
+  node -> size = 1 + gapSize(node -> left) + gapSize(node -> right);
+}
+
+// Orders entries by gap, then by lower key.
+int compareGaps(long long gap, int lower, GapNode * node) {
+  if (gap != node -> gap) {
+    return (gap < node -> gap) ? -1 : 1;
+  }
+  return (lower > node -> lower) - (lower < node -> lower);
+}
+
+GapNode * gapRotateRight(GapNode * node) {
+  GapNode * x = node -> left;
+  node -> left = x -> right;
+  x -> right = node;
+  updateGapNode(node);
+  updateGapNode(x);
+  return x;
+}
+
+GapNode * gapRotateLeft(GapNode * node) {
+  GapNode * x = node -> right;
+  node -> right = x -> left;
+  x -> left = node;
+  updateGapNode(node);
+  updateGapNode(x);
+  return x;
+}
+
+GapNode * gapRebalance(GapNode * node) {
+  updateGapNode(node);
+  int balance = gapHeight(node -> left) - gapHeight(node -> right);
+  if (balance > 1) {
+    if (gapHeight(node -> left -> left) < gapHeight(node -> left -> right)) {
+      node -> left = gapRotateLeft(node -> left);
+    }
+    node = gapRotateRight(node);
+  } else if (balance < -1) {
+    if (gapHeight(node -> right -> right) < gapHeight(node -> right -> left)) {
+      node -> right = gapRotateRight(node -> right);
+    }
+    node = gapRotateLeft(node);
+  }
+  return node;
+}
+
+GapNode * addGap(GapNode * node, long long gap, int lower) {
+  if (node == NULL) {
+    GapNode * created = malloc(sizeof(GapNode));
+    created -> gap = gap;
+    created -> lower = lower;
+    created -> left = NULL;
+    created -> right = NULL;
+    updateGapNode(created);
+    return created;
+  }
+  if (compareGaps(gap, lower, node) < 0) {
+    node -> left = addGap(node -> left, gap, lower);
+  } else {
+    node -> right = addGap(node -> right, gap, lower);
+  }
+  return gapRebalance(node);
+}
+
+// Detaches the smallest entry below 'node' into 'min'; returns the rest.
+GapNode * removeMinGap(GapNode * node, GapNode ** min) {
+  if (node -> left == NULL) {
+    * min = node;
+    return node -> right;
+  }
+  node -> left = removeMinGap(node -> left, min);
+  return gapRebalance(node);
+}
+
+GapNode * removeGap(GapNode * node, long long gap, int lower) {
+  if (node == NULL) {
+    return NULL;
+  }
+  int order = compareGaps(gap, lower, node);
+  if (order < 0) {
+    node -> left = removeGap(node -> left, gap, lower);
+  } else if (order > 0) {
+    node -> right = removeGap(node -> right, gap, lower);
+  } else {
+    GapNode * left = node -> left;
+    GapNode * right = node -> right;
+    free(node);
+    if (right == NULL) {
+      return left;
+    }
+    GapNode * min;
+    right = removeMinGap(right, & min);
+    min -> left = left;
+    min -> right = right;
+    node = min;
+  }
+  return gapRebalance(node);
+}
+
+void freeGapNodes(GapNode * node) {
+  if (node != NULL) {
+    freeGapNodes(node -> left);
+    freeGapNodes(node -> right);
+    free(node);
+  }
+}
+
+/*************************************************************************
+ ** Gap index operations
+ *************************************************************************/
+
+GapIndex * newGapIndex() {
+  GapIndex * gaps = malloc(sizeof(GapIndex));
+  gaps -> root = NULL;
+  return gaps;
+}
+
+closest_AVL_Node * insertWithGaps(closest_AVL_Node * root, GapIndex * gaps,
+  int key, void * value) {
+  if (search(root, key) == NULL) {
+    // 'key' splits the gap between its neighbours in two.
+    closest_AVL_Node * lower = floorNode(root, key);
+    closest_AVL_Node * upper = ceilingNode(root, key);
+    if (lower != NULL && upper != NULL) {
+      gaps -> root = removeGap(gaps -> root,
+        (long long) upper -> key - lower -> key, lower -> key);
+    }
+    if (lower != NULL) {
+      gaps -> root = addGap(gaps -> root,
+        (long long) key - lower -> key, lower -> key);
+    }
+    if (upper != NULL) {
+      gaps -> root = addGap(gaps -> root,
+        (long long) upper -> key - key, key);
+    }
+  }
+  return insert(root, key, value);
+}
+
+closest_AVL_Node * deleteWithGaps(closest_AVL_Node * root, GapIndex * gaps,
+  int key) {
+  if (search(root, key) == NULL) {
+    return root;
+  }
+  root = delete(root, key);
+
+  // The two gaps around 'key' merge into one.
+  closest_AVL_Node * lower = floorNode(root, key);
+  closest_AVL_Node * upper = ceilingNode(root, key);
+  if (lower != NULL) {
+    gaps -> root = removeGap(gaps -> root,
+      (long long) key - lower -> key, lower -> key);
+  }
+  if (upper != NULL) {
+    gaps -> root = removeGap(gaps -> root,
+      (long long) upper -> key - key, key);
+  }
+  if (lower != NULL && upper != NULL) {
+    gaps -> root = addGap(gaps -> root,
+      (long long) upper -> key - lower -> key, lower -> key);
+  }
+  return root;
+}
+
+long gapCount(GapIndex * gaps) {
+  return gapSize(gaps -> root);
+}
+
+long long kthSmallestGap(GapIndex * gaps, long k) {
+  if (k < 1 || k > gapSize(gaps -> root)) {
+    return -1;
+  }
+  GapNode * node = gaps -> root;
+  while (true) {
+    long leftSize = gapSize(node -> left);
+    if (k <= leftSize) {
+      node = node -> left;
+    } else if (k == leftSize + 1) {
+      return node -> gap;
+    } else {
+      k -= leftSize + 1;
+      node = node -> right;
+    }
+  }
+}
+
+long long gapQuantile(GapIndex * gaps, double q) {
+  long n = gapSize(gaps -> root);
+  long k = (long) ceil(q * n);
+  if (k < 1) {
+    k = 1;
+  } else if (k > n) {
+    k = n;
+  }
+  return kthSmallestGap(gaps, k);
+}
+
+long countGapsBelow(GapIndex * gaps, long long d) {
+  long count = 0;
+  GapNode * node = gaps -> root;
+  while (node != NULL) {
+    if (node -> gap < d) {
+      count += gapSize(node -> left) + 1;
+      node = node -> right;
+    } else {
+      node = node -> left;
+    }
+  }
+  return count;
+}
+
+void deleteGapIndex(GapIndex * gaps) {
+  freeGapNodes(gaps -> root);
+  free(gaps);
+}
@@ -0,0 +1,74 @@
+/*
+ *  Header file for the order-statistic index over adjacent gaps.
+ *
+ *  A secondary AVL tree holding one entry per pair of adjacent keys of a
+ *  closest-AVL tree, ordered by gap (ties broken by the lower key) and
+ *  augmented with subtree sizes. Updating a key changes at most three
+ *  gaps, so insertWithGaps/deleteWithGaps keep the index current in
+ *  O(log n), and rank queries over the gaps (k-th smallest, quantiles,
+ *  count below a threshold) are O(log n) as well.
+ */
+
+#include "closest_AVL_tree.h"
+
+#ifndef __gap_index_header
+#define __gap_index_header
+
+typedef struct gap_node
+{
+  long long gap;            // upper - lower
+  int lower;                // lower key of the adjacent pair
+  int height;               // height of the subtree rooted at this node
+  long size;                // number of entries in this subtree
+  struct gap_node* left;
+  struct gap_node* right;
+} GapNode;
+
+typedef struct gap_index
+{
+  GapNode* root;
+} GapIndex;
+
+/*
+ * Returns a new empty gap index.
+ */
+GapIndex* newGapIndex();
+
+/*
+ * Same as 'insert' / 'delete' on the closest-AVL tree rooted at 'root',
+ * also updating 'gaps', which must describe that tree. Return the new root.
+ */
+closest_AVL_Node* insertWithGaps(closest_AVL_Node* root, GapIndex* gaps,
+    int key, void* value);
+closest_AVL_Node* deleteWithGaps(closest_AVL_Node* root, GapIndex* gaps,
+    int key);
+
+/*
+ * Returns the number of gaps in 'gaps' (one less than the number of keys,
+ * or 0).
+ */
+long gapCount(GapIndex* gaps);
+
+/*
+ * Returns the k-th smallest gap, k = 1 being the closest pair's. Returns
+ * -1 if k is not in 1..gapCount(gaps).
+ */
+long long kthSmallestGap(GapIndex* gaps, long k);
+
+/*
+ * Returns the q-quantile of the gaps (0 <= q <= 1) by the nearest-rank
+ * method, e.g. q = 0.5 gives the median. Returns -1 if there are no gaps.
+ */
+long long gapQuantile(GapIndex* gaps, double q);
+
+/*
+ * Returns the number of gaps strictly smaller than 'd'.
+ */
+long countGapsBelow(GapIndex* gaps, long long d);
+
+/*
+ * Frees all memory allocated for 'gaps'.
+ */
+void deleteGapIndex(GapIndex* gaps);
+
+#endif
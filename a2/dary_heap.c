@@ -0,0 +1,14 @@
+/*
+ * d-ary MinHeap variants: one instantiation of dary_heap_impl.h per arity
+ * declared in dary_heap.h.
+ */
+
+#include "dary_heap.h"
+
+#define DARY_ARITY 4
+#include "dary_heap_impl.h"
+#undef DARY_ARITY
+
+#define DARY_ARITY 8
+#include "dary_heap_impl.h"
+#undef DARY_ARITY
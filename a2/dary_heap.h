@@ -0,0 +1,37 @@
+/*
+ * Header file for the d-ary MinHeap variants.
+ *
+ * Same heap as minheap.h, but every node has DARY_ARITY children, fixed at
+ * compile time: dary_heap_template.h is instantiated once per arity, and
+ * every type and function name gets the arity as a suffix (MinHeap4,
+ * insert4, MinHeap8, insert8, ...). A higher arity makes the heap
+ * shallower (log_d n levels), at the price of more comparisons per level
+ * on the way down.
+ *
+ * The root is at index ROOT_INDEX (1) and the children of node i are at
+ * d*(i-1)+2 .. d*(i-1)+d+1. The array is allocated so that arr[2] starts
+ * a cache line; since d * sizeof(HeapNode) divides 64 for d = 4 and 8, the
+ * children of any node then share one cache line, and picking the
+ * smallest of them costs a single miss.
+ */
+
+#include "minheap.h"
+
+#ifndef __DaryHeap_header
+#define __DaryHeap_header
+
+#define CACHE_LINE_SIZE 64
+
+#define DARY_CAT_(name, arity) name##arity
+#define DARY_CAT(name, arity) DARY_CAT_(name, arity)
+#define DARY(name) DARY_CAT(name, DARY_ARITY)
+
+#define DARY_ARITY 4
+#include "dary_heap_template.h"
+#undef DARY_ARITY
+
+#define DARY_ARITY 8
+#include "dary_heap_template.h"
+#undef DARY_ARITY
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Definitions of one d-ary MinHeap instantiation. Included by dary_heap.c
+ * once per arity, with DARY_ARITY defined; do not include it directly.
+ */
+
+/*
+ * Returns the index of the parent / first child of the node at index
+ * 'nodeIndex', assuming it exists.
+ */
+static inline int DARY(getParentIdx)(int nodeIndex)
+{
+  return (nodeIndex - 2) / DARY_ARITY + 1;
+}
+
+static inline int DARY(getFirstChildIdx)(int nodeIndex)
+{
+  return DARY_ARITY * (nodeIndex - 1) + 2;
+}
+
+/*
+ * Moves 'node' up from index 'nodeIndex', which is a hole: parents with a
+ * larger priority move down into it, and 'node' is written once at the end.
+ */
+static void DARY(siftUp)(DARY(MinHeap)* heap, int nodeIndex, HeapNode node)
+{
+  HeapNode* arr = heap->arr;
+  while (nodeIndex > ROOT_INDEX)
+  {
+    int parent = DARY(getParentIdx)(nodeIndex);
+    if (arr[parent].priority <= node.priority)
+    {
+      break;
+    }
+    arr[nodeIndex] = arr[parent];
+    nodeIndex = parent;
+  }
+  arr[nodeIndex] = node;
+}
+
+/*
+ * Same as siftUp, but moving down: the smallest child moves up into the
+ * hole while it is smaller than 'node'.
+ */
+static void DARY(siftDown)(DARY(MinHeap)* heap, int nodeIndex, HeapNode node)
+{
+  HeapNode* arr = heap->arr;
+  int size = heap->size;
+  int first;
+  while ((first = DARY(getFirstChildIdx)(nodeIndex)) <= size)
+  {
+    int last = first + DARY_ARITY - 1;
+    if (last > size)
+    {
+      last = size;
+    }
+    int smallest = first;
+    for (int child = first + 1; child <= last; child++)
+    {
+      if (arr[child].priority < arr[smallest].priority)
+      {
+        smallest = child;
+      }
+    }
+    if (arr[smallest].priority >= node.priority)
+    {
+      break;
+    }
+    arr[nodeIndex] = arr[smallest];
+    nodeIndex = smallest;
+  }
+  arr[nodeIndex] = node;
+}
+
+HeapNode DARY(getMin)(DARY(MinHeap)* heap)
+{
+  return heap->arr[ROOT_INDEX];
+}
+
+void DARY(heapify)(DARY(MinHeap)* heap, int nodeIndex)
+{
+  DARY(siftDown)(heap, nodeIndex, heap->arr[nodeIndex]);
+}
+
+HeapNode DARY(extractMin)(DARY(MinHeap)* heap)
+{
+  HeapNode result = heap->arr[ROOT_INDEX];
+  HeapNode last = heap->arr[heap->size];
+  heap->size -= 1;
+  if (heap->size > 0)
+  {
+    DARY(siftDown)(heap, ROOT_INDEX, last);
+  }
+  return result;
+}
+
+bool DARY(insert)(DARY(MinHeap)* heap, int priority, int id)
+{
+  if (heap->size == heap->capacity)
+  {
+    return false;
+  }
+  HeapNode node = { priority, id };
+  heap->size += 1;
+  DARY(siftUp)(heap, heap->size, node);
+  return true;
+}
+
+void DARY(changePriority)(DARY(MinHeap)* heap, int nodeIndex, int newPriority)
+{
+  HeapNode node = heap->arr[nodeIndex];
+  int oldPriority = node.priority;
+  node.priority = newPriority;
+  if (newPriority < oldPriority)
+  {
+    DARY(siftUp)(heap, nodeIndex, node);
+  }
+  else
+  {
+    DARY(siftDown)(heap, nodeIndex, node);
+  }
+}
+
+DARY(MinHeap)* DARY(newHeap)(int capacity)
+{
+  DARY(MinHeap)* heap = (DARY(MinHeap)*) malloc(sizeof(DARY(MinHeap)));
+  heap->size = 0;
+  heap->capacity = capacity;
+
+  // arr[0] and arr[1] sit just before the first cache line, so that every
+  // group of siblings, starting at arr[2], is line aligned.
+  size_t offset = CACHE_LINE_SIZE - 2 * sizeof(HeapNode);
+  size_t bytes = offset + sizeof(HeapNode) * (capacity + 1);
+  bytes = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  heap->block = aligned_alloc(CACHE_LINE_SIZE, bytes);
+  heap->arr = (HeapNode*) ((char*) heap->block + offset);
+  return heap;
+}
+
+void DARY(deleteHeap)(DARY(MinHeap)* heap)
+{
+  free(heap->block);
+  free(heap);
+}
+
+DARY(MinHeap)* DARY(buildHeap)(int values[], int size)
+{
+  DARY(MinHeap)* heap = DARY(newHeap)(size);
+  heap->size = size;
+
+  for (int i = 0; i < size; i++)
+  {
+    heap->arr[i + 1].priority = values[i];
+    heap->arr[i + 1].id = i;
+  }
+
+  for (int i = DARY(getParentIdx)(size); i >= ROOT_INDEX; i--)
+  {
+    DARY(heapify)(heap, i);
+  }
+
+  return heap;
+}
@@ -0,0 +1,26 @@
+/*
+ * Declarations of one d-ary MinHeap instantiation. Included by dary_heap.h
+ * once per arity, with DARY_ARITY defined; do not include it directly.
+ * Every function behaves like its minheap.h namesake.
+ */
+
+typedef struct DARY(min_heap) {
+  int size;       // the number of nodes in this heap; 0 <= size <= capacity
+  int capacity;   // the number of nodes that can be stored in this heap
+  HeapNode* arr;  // the nodes, arr[ROOT_INDEX .. size]
+  void* block;    // the allocation 'arr' points into
+} DARY(MinHeap);
+
+HeapNode DARY(getMin)(DARY(MinHeap)* heap);
+void DARY(heapify)(DARY(MinHeap)* heap, int nodeIndex);
+HeapNode DARY(extractMin)(DARY(MinHeap)* heap);
+bool DARY(insert)(DARY(MinHeap)* heap, int priority, int id);
+void DARY(changePriority)(DARY(MinHeap)* heap, int nodeIndex, int newPriority);
+DARY(MinHeap)* DARY(newHeap)(int capacity);
+void DARY(deleteHeap)(DARY(MinHeap)* heap);
+
+/*
+ * Builds a heap for priorities 'values' for IDs '0' to 'size-1' bottom-up,
+ * in O(n).
+ */
+DARY(MinHeap)* DARY(buildHeap)(int values[], int size);
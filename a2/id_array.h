@@ -0,0 +1,41 @@
+/*
+ * Growth of arrays indexed by node ID, shared by the heaps that address
+ * their nodes by dense IDs (PairingHeap, RadixHeap).
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifndef __IdArray_header
+#define __IdArray_header
+
+/*
+ * Grows 'array', of '*capacity' elements of 'size' bytes each, at least
+ * doubling it, so that index 'id' fits. The new elements, from the old
+ * '*capacity' on, are not initialized.
+ * Returns: the grown array, with its new capacity in '*capacity', or NULL
+ *   if out of memory or if 'id' is INT_MAX, which no int capacity can
+ *   hold ('array' and '*capacity' are then unchanged)
+ */
+static inline void* growIdArray(void* array, size_t size, int* capacity,
+                                int id)
+{
+  if (id == INT_MAX)
+  {
+    return NULL;
+  }
+  int grown = (*capacity > INT_MAX / 2) ? INT_MAX : 2 * *capacity;
+  if (grown <= id)
+  {
+    grown = id + 1;
+  }
+  array = realloc(array, size * (size_t) grown);
+  if (array != NULL)
+  {
+    *capacity = grown;
+  }
+  return array;
+}
+
+#endif
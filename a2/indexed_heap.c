@@ -0,0 +1,339 @@
+/*
+ * IndexedHeap implementation.
+ */
+
+#include <limits.h>
+
+#include "indexed_heap.h"
+
+#define MIN_TABLE_SIZE 16
+
+/*************************************************************************
+ ** Table helper functions
+ *************************************************************************/
+
+/*
+ * Returns the home slot of 'id' in a table of 'tableSize' slots. The
+ * multiplication spreads IDs that differ only in their high bits, or that
+ * are multiples of a power of 2, over the whole table.
+ */
+uint32_t homeSlot(uint64_t id, uint32_t tableSize)
+{
+  uint64_t hash = id * 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 32;
+  return (uint32_t) hash & (tableSize - 1);
+}
+
+/*
+ * Returns the slot of the entry of 'id' in the table of 'heap', or
+ * NOTHING if there is none.
+ */
+long long findSlot(IndexedHeap* heap, uint64_t id)
+{
+  uint32_t mask = heap->tableSize - 1;
+  for (uint32_t slot = homeSlot(id, heap->tableSize); ; slot = (slot + 1) & mask)
+  {
+    if (heap->table[slot].index == NOTHING)
+    {
+      return NOTHING;
+    }
+    if (heap->table[slot].id == id)
+    {
+      return slot;
+    }
+  }
+}
+
+/*
+ * Stores an entry mapping 'id' to 'index' in the first free slot of its
+ * probe run, and points the node at 'index' to it.
+ * Precondition: 'id' is not in the table, which has a free slot
+ */
+void placeEntry(IndexedHeap* heap, uint64_t id, int index)
+{
+  uint32_t mask = heap->tableSize - 1;
+  uint32_t slot = homeSlot(id, heap->tableSize);
+  while (heap->table[slot].index != NOTHING)
+  {
+    slot = (slot + 1) & mask;
+  }
+  heap->table[slot].id = id;
+  heap->table[slot].index = index;
+  heap->arr[index].slot = slot;
+}
+
+/*
+ * Frees slot 'slot' of the table of 'heap'. Every later entry of the probe
+ * run that may move back, because its home slot is not between the hole
+ * and itself, fills the hole, which moves to where it was.
+ */
+void removeEntry(IndexedHeap* heap, uint32_t slot)
+{
+  uint32_t mask = heap->tableSize - 1;
+  uint32_t hole = slot;
+  for (uint32_t next = (hole + 1) & mask; heap->table[next].index != NOTHING;
+       next = (next + 1) & mask)
+  {
+    uint32_t home = homeSlot(heap->table[next].id, heap->tableSize);
+    // the distance from the home slot to 'next' must cover the hole
+    if (((next - home) & mask) >= ((next - hole) & mask))
+    {
+      heap->table[hole] = heap->table[next];
+      heap->arr[heap->table[hole].index].slot = hole;
+      hole = next;
+    }
+  }
+  heap->table[hole].index = NOTHING;
+}
+
+/*
+ * Rebuilds the table of 'heap' with 'tableSize' slots.
+ * Returns: true if successful, false otherwise ('heap' is unchanged)
+ */
+bool resizeTable(IndexedHeap* heap, uint32_t tableSize)
+{
+  IndexedSlot* table = (IndexedSlot*) malloc(sizeof(IndexedSlot) * tableSize);
+  if (table == NULL)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < tableSize; i++)
+  {
+    table[i].index = NOTHING;
+  }
+  free(heap->table);
+  heap->table = table;
+  heap->tableSize = tableSize;
+  for (int i = ROOT_INDEX; i <= heap->size; i++)
+  {
+    placeEntry(heap, heap->arr[i].id, i);
+  }
+  return true;
+}
+
+/*************************************************************************
+ ** Heap helper functions
+ *************************************************************************/
+
+/*
+ * Stores 'node' at index 'nodeIndex' and points its table entry there.
+ */
+static inline void setNode(IndexedHeap* heap, int nodeIndex, IndexedNode node)
+{
+  heap->arr[nodeIndex] = node;
+  heap->table[node.slot].index = nodeIndex;
+}
+
+/*
+ * Moves 'node' up from the hole at index 'nodeIndex', as siftUp in
+ * minheap.c does, updating the table entry of every node it moves.
+ */
+void indexedSiftUp(IndexedHeap* heap, int nodeIndex, IndexedNode node)
+{
+  while (nodeIndex > ROOT_INDEX)
+  {
+    int parent = nodeIndex / 2;
+    if (heap->arr[parent].priority <= node.priority)
+    {
+      break;
+    }
+    setNode(heap, nodeIndex, heap->arr[parent]);
+    nodeIndex = parent;
+  }
+  setNode(heap, nodeIndex, node);
+}
+
+/*
+ * Same as indexedSiftUp, but moving down.
+ */
+void indexedSiftDown(IndexedHeap* heap, int nodeIndex, IndexedNode node)
+{
+  int size = heap->size;
+  int child;
+  while ((child = 2 * nodeIndex) <= size)
+  {
+    if (child < size && heap->arr[child + 1].priority < heap->arr[child].priority)
+    {
+      child++;
+    }
+    if (heap->arr[child].priority >= node.priority)
+    {
+      break;
+    }
+    setNode(heap, nodeIndex, heap->arr[child]);
+    nodeIndex = child;
+  }
+  setNode(heap, nodeIndex, node);
+}
+
+/*
+ * Removes the node at index 'nodeIndex' from 'heap': the last node takes
+ * its place and moves up or down from there.
+ */
+void removeAt(IndexedHeap* heap, int nodeIndex)
+{
+  removeEntry(heap, heap->arr[nodeIndex].slot);
+  IndexedNode last = heap->arr[heap->size];
+  heap->size -= 1;
+  if (nodeIndex > heap->size)
+  {
+    return;
+  }
+  if (last.priority < heap->arr[nodeIndex].priority)
+  {
+    indexedSiftUp(heap, nodeIndex, last);
+  }
+  else
+  {
+    indexedSiftDown(heap, nodeIndex, last);
+  }
+}
+
+/*************************************************************************
+ ** Heap operations
+ *************************************************************************/
+
+IndexedHeap* newIndexedHeap(int capacity)
+{
+  IndexedHeap* heap = (IndexedHeap*) malloc(sizeof(IndexedHeap));
+  if (heap == NULL)
+  {
+    return NULL;
+  }
+  heap->size = 0;
+  heap->capacity = capacity;
+  heap->arr = (IndexedNode*) malloc(sizeof(IndexedNode) * ((size_t) capacity + 1));
+  heap->table = NULL;
+
+  // keep the table at most half full for short probe runs
+  uint32_t tableSize = MIN_TABLE_SIZE;
+  while (tableSize < 2 * (uint64_t) capacity && tableSize <= UINT32_MAX / 2)
+  {
+    tableSize *= 2;
+  }
+  if (heap->arr == NULL || !resizeTable(heap, tableSize))
+  {
+    deleteIndexedHeap(heap);
+    return NULL;
+  }
+  return heap;
+}
+
+IndexedNode indexedGetMin(IndexedHeap* heap)
+{
+  return heap->arr[ROOT_INDEX];
+}
+
+IndexedNode indexedExtractMin(IndexedHeap* heap)
+{
+  IndexedNode result = heap->arr[ROOT_INDEX];
+  removeAt(heap, ROOT_INDEX);
+  return result;
+}
+
+bool indexedInsert(IndexedHeap* heap, int priority, uint64_t id)
+{
+  if (findSlot(heap, id) != NOTHING)
+  {
+    return false;
+  }
+  // grow the array by doubling, and the table to stay at most half full
+  if (heap->size == heap->capacity)
+  {
+    if (heap->capacity == INT_MAX - 1)
+    {
+      return false;
+    }
+    int capacity = (heap->capacity > INT_MAX / 2) ? INT_MAX - 1 :
+                   (heap->capacity > 0) ? 2 * heap->capacity : 1;
+    IndexedNode* arr = (IndexedNode*) realloc(heap->arr,
+        sizeof(IndexedNode) * ((size_t) capacity + 1));
+    if (arr == NULL)
+    {
+      return false;
+    }
+    heap->arr = arr;
+    heap->capacity = capacity;
+  }
+  if (2 * ((uint64_t) heap->size + 1) > heap->tableSize &&
+      (heap->tableSize > UINT32_MAX / 2 || !resizeTable(heap, 2 * heap->tableSize)))
+  {
+    return false;
+  }
+
+  heap->size += 1;
+  IndexedNode node = { priority, 0, id };
+  heap->arr[heap->size] = node;
+  placeEntry(heap, id, heap->size);
+  indexedSiftUp(heap, heap->size, heap->arr[heap->size]);
+  return true;
+}
+
+bool indexedGetPriority(IndexedHeap* heap, uint64_t id, int* priority)
+{
+  long long slot = findSlot(heap, id);
+  if (slot == NOTHING)
+  {
+    return false;
+  }
+  *priority = heap->arr[heap->table[slot].index].priority;
+  return true;
+}
+
+bool indexedDecreasePriority(IndexedHeap* heap, uint64_t id, int newPriority)
+{
+  long long slot = findSlot(heap, id);
+  if (slot == NOTHING)
+  {
+    return false;
+  }
+  int nodeIndex = heap->table[slot].index;
+  IndexedNode node = heap->arr[nodeIndex];
+  if (node.priority <= newPriority)
+  {
+    return false;
+  }
+  node.priority = newPriority;
+  indexedSiftUp(heap, nodeIndex, node);
+  return true;
+}
+
+bool indexedChangePriority(IndexedHeap* heap, uint64_t id, int newPriority)
+{
+  long long slot = findSlot(heap, id);
+  if (slot == NOTHING)
+  {
+    return false;
+  }
+  int nodeIndex = heap->table[slot].index;
+  IndexedNode node = heap->arr[nodeIndex];
+  int oldPriority = node.priority;
+  node.priority = newPriority;
+  if (newPriority < oldPriority)
+  {
+    indexedSiftUp(heap, nodeIndex, node);
+  }
+  else
+  {
+    indexedSiftDown(heap, nodeIndex, node);
+  }
+  return true;
+}
+
+bool indexedRemove(IndexedHeap* heap, uint64_t id)
+{
+  long long slot = findSlot(heap, id);
+  if (slot == NOTHING)
+  {
+    return false;
+  }
+  removeAt(heap, heap->table[slot].index);
+  return true;
+}
+
+void deleteIndexedHeap(IndexedHeap* heap)
+{
+  free(heap->arr);
+  free(heap->table);
+  free(heap);
+}
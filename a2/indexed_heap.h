@@ -0,0 +1,98 @@
+/*
+ * Header file for the IndexedHeap, a MinHeap addressed by node ID.
+ *
+ * Same binary heap as minheap.h, except that nodes are found by their ID
+ * rather than by their index, so that their priority can be changed, or
+ * they can be removed, in O(log n). IDs are arbitrary 64-bit values: the
+ * heap keeps an open-addressing hash table (linear probing, at most half
+ * full) from ID to index. Each heap node stores the slot of its table
+ * entry, so the sift loops keep the table up to date without hashing.
+ * Deletions shift later entries of a probe run back instead of leaving
+ * tombstones, so lookups never slow down over time.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "minheap.h"
+
+#ifndef __IndexedHeap_header
+#define __IndexedHeap_header
+
+typedef struct indexed_node {
+  int priority;   // priority of this node
+  uint32_t slot;  // the slot of this node's entry in the table
+  uint64_t id;    // the unique ID of this node
+} IndexedNode;
+
+typedef struct indexed_slot {
+  uint64_t id;    // the ID of the node of this entry
+  int index;      // its index in the heap array, NOTHING if the slot is free
+} IndexedSlot;
+
+typedef struct indexed_heap {
+  int size;            // the number of nodes in this heap
+  int capacity;        // the number of nodes that fit in 'arr'
+  IndexedNode* arr;    // the nodes, arr[ROOT_INDEX .. size]
+  IndexedSlot* table;  // the ID -> index table
+  uint32_t tableSize;  // the number of slots in 'table', a power of 2
+} IndexedHeap;
+
+/*
+ * Returns a newly created empty heap with initial capacity 'capacity', or
+ * NULL if out of memory. The capacity grows as needed.
+ * Precondition: capacity >= 0
+ */
+IndexedHeap* newIndexedHeap(int capacity);
+
+/*
+ * Returns the node with minimum priority in 'heap'.
+ * Precondition: 'heap' is non-empty
+ */
+IndexedNode indexedGetMin(IndexedHeap* heap);
+
+/*
+ * Removes and returns the node with minimum priority in 'heap'.
+ * Precondition: 'heap' is non-empty
+ */
+IndexedNode indexedExtractMin(IndexedHeap* heap);
+
+/*
+ * Inserts a new node with priority 'priority' and ID 'id' into 'heap'.
+ * Returns: true if successful, false if 'heap' already has a node with ID
+ *   'id' or is out of memory
+ */
+bool indexedInsert(IndexedHeap* heap, int priority, uint64_t id);
+
+/*
+ * Stores the priority of the node with ID 'id' in 'priority'.
+ * Returns: true if 'heap' has such a node, false otherwise
+ */
+bool indexedGetPriority(IndexedHeap* heap, uint64_t id, int* priority);
+
+/*
+ * Sets the priority of the node with ID 'id' in 'heap' to 'newPriority',
+ * if such a node exists and its priority is larger than 'newPriority', and
+ * returns true. Has no effect and returns false otherwise.
+ */
+bool indexedDecreasePriority(IndexedHeap* heap, uint64_t id, int newPriority);
+
+/*
+ * Sets the priority of the node with ID 'id' in 'heap' to 'newPriority',
+ * up or down.
+ * Returns: true if 'heap' has such a node, false otherwise
+ */
+bool indexedChangePriority(IndexedHeap* heap, uint64_t id, int newPriority);
+
+/*
+ * Removes the node with ID 'id' from 'heap'.
+ * Returns: true if 'heap' had such a node, false otherwise
+ */
+bool indexedRemove(IndexedHeap* heap, uint64_t id);
+
+/*
+ * Frees all memory allocated for 'heap'.
+ */
+void deleteIndexedHeap(IndexedHeap* heap);
+
+#endif
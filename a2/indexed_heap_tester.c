@@ -0,0 +1,204 @@
+/*
+ * Model test of the IndexedHeap: random operations are applied both to a
+ * heap and to a plain array of IDs and priorities, and the results are
+ * compared after every step. After every removal, which shifts table
+ * entries back, the heap order, the slot <-> index links and every
+ * lookup are checked in full.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "indexed_heap.h"
+
+#define NUM_IDS 2000
+#define NUM_STEPS 200000
+#define MAX_PRIORITY 1000
+
+uint64_t ids[NUM_IDS];        // the IDs used, scattered over 64 bits
+int priorities[NUM_IDS];      // priorities[i] is the priority of ids[i]
+bool inHeap[NUM_IDS];         // inHeap[i] is true if ids[i] is in the heap
+int count = 0;                // the number of IDs in the heap
+
+/*
+ * Returns: true if 'heap' is a heap, every node and its table entry point
+ *   to each other, and the table has no other entries
+ */
+bool checkStructure(IndexedHeap* heap)
+{
+  for (int i = ROOT_INDEX + 1; i <= heap->size; i++)
+  {
+    if (heap->arr[i / 2].priority > heap->arr[i].priority)
+    {
+      return false;
+    }
+  }
+  for (int i = ROOT_INDEX; i <= heap->size; i++)
+  {
+    IndexedNode node = heap->arr[i];
+    if (node.slot >= heap->tableSize || heap->table[node.slot].index != i ||
+        heap->table[node.slot].id != node.id)
+    {
+      return false;
+    }
+  }
+  int used = 0;
+  for (uint32_t slot = 0; slot < heap->tableSize; slot++)
+  {
+    used += heap->table[slot].index != NOTHING;
+  }
+  return used == heap->size;
+}
+
+/*
+ * Returns: true if every ID of the model is found in 'heap' with its
+ *   priority, and no other ID is found. A hole left in a probe run would
+ *   hide the entries after it.
+ */
+bool checkLookups(IndexedHeap* heap)
+{
+  for (int i = 0; i < NUM_IDS; i++)
+  {
+    int priority;
+    bool found = indexedGetPriority(heap, ids[i], &priority);
+    if (found != inHeap[i] || (found && priority != priorities[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the model index of 'id'.
+int modelIndex(uint64_t id)
+{
+  for (int i = 0; i < NUM_IDS; i++)
+  {
+    if (ids[i] == id)
+    {
+      return i;
+    }
+  }
+  return NOTHING;
+}
+
+// Returns the minimum priority of the model, or MAX_PRIORITY if empty.
+int modelMin()
+{
+  int min = MAX_PRIORITY;
+  for (int i = 0; i < NUM_IDS; i++)
+  {
+    if (inHeap[i] && priorities[i] < min)
+    {
+      min = priorities[i];
+    }
+  }
+  return min;
+}
+
+/*
+ * Applies one random operation to 'heap' and the model.
+ * Returns: true if 'heap' behaved as the model predicts
+ */
+bool randomStep(IndexedHeap* heap)
+{
+  int i = rand() % NUM_IDS;
+  int priority = rand() % MAX_PRIORITY;
+  switch (rand() % 6)
+  {
+  case 0:
+  case 1:
+    if (indexedInsert(heap, priority, ids[i]) == inHeap[i])
+    {
+      return false;
+    }
+    if (!inHeap[i])
+    {
+      inHeap[i] = true;
+      priorities[i] = priority;
+      count++;
+    }
+    return true;
+  case 2:
+  {
+    bool expected = inHeap[i] && priority < priorities[i];
+    if (indexedDecreasePriority(heap, ids[i], priority) != expected)
+    {
+      return false;
+    }
+    if (expected)
+    {
+      priorities[i] = priority;
+    }
+    return true;
+  }
+  case 3:
+    if (indexedChangePriority(heap, ids[i], priority) != inHeap[i])
+    {
+      return false;
+    }
+    if (inHeap[i])
+    {
+      priorities[i] = priority;
+    }
+    return true;
+  case 4:
+    if (indexedRemove(heap, ids[i]) != inHeap[i])
+    {
+      return false;
+    }
+    if (inHeap[i])
+    {
+      inHeap[i] = false;
+      count--;
+    }
+    return checkStructure(heap) && checkLookups(heap);
+  default:
+  {
+    if (heap->size == 0)
+    {
+      return true;
+    }
+    IndexedNode node = indexedExtractMin(heap);
+    int j = modelIndex(node.id);
+    if (j == NOTHING || !inHeap[j] || priorities[j] != node.priority ||
+        node.priority != modelMin())
+    {
+      return false;
+    }
+    inHeap[j] = false;
+    count--;
+    return checkStructure(heap) && checkLookups(heap);
+  }
+  }
+}
+
+int main()
+{
+  srand(5);
+  // IDs that share low bits or differ only in high bits, to test hashing
+  for (int i = 0; i < NUM_IDS; i++)
+  {
+    ids[i] = ((uint64_t) rand() << 40) ^ ((uint64_t) (i & 7) << 60) ^
+             (uint64_t) i * 1024;
+  }
+
+  IndexedHeap* heap = newIndexedHeap(0);
+  if (heap == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  for (int step = 0; step < NUM_STEPS; step++)
+  {
+    if (!randomStep(heap) || heap->size != count)
+    {
+      printf("FAILED at step %d\n", step);
+      deleteIndexedHeap(heap);
+      return 1;
+    }
+  }
+  bool ok = checkStructure(heap) && checkLookups(heap);
+  deleteIndexedHeap(heap);
+  printf(ok ? "All indexed heap tests passed\n" : "FAILED at the end\n");
+  return ok ? 0 : 1;
+}
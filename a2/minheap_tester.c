@@ -112,11 +112,6 @@ void testHeap(MinHeap* heap)
     }
     else if (line[0] == 'i') // insert
     {
-      if (heap->size == heap->capacity)
-      {
-        printf("Heap is full: can't insert. Choose another command.\n");
-        continue;
-      }
       printf("insert selected. Enter priority to insert: ");
       fgets(line, MAX_LIMIT, stdin);
       priority = atoi(line);
@@ -0,0 +1,250 @@
+/*
+ * PairingHeap implementation.
+ */
+
+#include "id_array.h"
+#include "pairing_heap.h"
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+/*
+ * Links the trees rooted at 'a' and 'b': the one with the larger priority
+ * becomes the leftmost child of the other.
+ * Returns: the ID of the root of the linked tree
+ * Precondition: 'a' and 'b' are roots of disjoint trees
+ */
+int linkTrees(PairingNode* pool, int a, int b)
+{
+  if (pool[b].priority < pool[a].priority)
+  {
+    int swap = a;
+    a = b;
+    b = swap;
+  }
+  pool[b].sibling = pool[a].child;
+  if (pool[a].child != NOTHING)
+  {
+    pool[pool[a].child].prev = b;
+  }
+  pool[b].prev = a;
+  pool[a].child = b;
+  return a;
+}
+
+/*
+ * Merges the list of trees starting at 'first' (linked by sibling) into
+ * one, in two passes: adjacent pairs are linked left to right, then the
+ * results are linked right to left. The first pass pushes its results on
+ * a stack threaded through 'sibling', so no extra memory is needed.
+ * Returns: the ID of the root of the merged tree, NOTHING if the list is
+ *   empty
+ */
+int mergePairs(PairingNode* pool, int first)
+{
+  int stack = NOTHING;
+  while (first != NOTHING)
+  {
+    int a = first;
+    int b = pool[a].sibling;
+    if (b == NOTHING)
+    {
+      pool[a].sibling = stack;
+      stack = a;
+      break;
+    }
+    first = pool[b].sibling;
+    int winner = linkTrees(pool, a, b);
+    pool[winner].sibling = stack;
+    stack = winner;
+  }
+
+  int root = stack;
+  if (root == NOTHING)
+  {
+    return NOTHING;
+  }
+  stack = pool[root].sibling;
+  while (stack != NOTHING)
+  {
+    int next = pool[stack].sibling;
+    root = linkTrees(pool, root, stack);
+    stack = next;
+  }
+  pool[root].sibling = NOTHING;
+  pool[root].prev = NOTHING;
+  return root;
+}
+
+/*
+ * Cuts the subtree rooted at 'id' out of the tree it is in.
+ * Precondition: 'id' is in the heap and not its root
+ */
+void cutTree(PairingNode* pool, int id)
+{
+  int prev = pool[id].prev;
+  int sibling = pool[id].sibling;
+  if (pool[prev].child == id)
+  {
+    pool[prev].child = sibling;
+  }
+  else
+  {
+    pool[prev].sibling = sibling;
+  }
+  if (sibling != NOTHING)
+  {
+    pool[sibling].prev = prev;
+  }
+  pool[id].sibling = NOTHING;
+  pool[id].prev = NOTHING;
+}
+
+/*
+ * Grows the pool of 'heap', at least doubling it, so that 'id' fits.
+ * Returns: true if successful, false otherwise ('heap' is unchanged)
+ */
+bool growPool(PairingHeap* heap, int id)
+{
+  int capacity = heap->capacity;
+  PairingNode* pool = (PairingNode*) growIdArray(heap->pool,
+      sizeof(PairingNode), &capacity, id);
+  if (pool == NULL)
+  {
+    return false;
+  }
+  for (int i = heap->capacity; i < capacity; i++)
+  {
+    pool[i].prev = DETACHED;
+  }
+  heap->pool = pool;
+  heap->capacity = capacity;
+  return true;
+}
+
+/*************************************************************************
+ ** Heap operations
+ *************************************************************************/
+
+PairingHeap* newPairingHeap(int capacity)
+{
+  PairingHeap* heap = (PairingHeap*) malloc(sizeof(PairingHeap));
+  if (heap == NULL)
+  {
+    return NULL;
+  }
+  heap->size = 0;
+  heap->capacity = 0;
+  heap->root = NOTHING;
+  heap->pool = NULL;
+  if (capacity > 0 && !growPool(heap, capacity - 1))
+  {
+    free(heap);
+    return NULL;
+  }
+  return heap;
+}
+
+HeapNode pairingGetMin(PairingHeap* heap)
+{
+  HeapNode result = { heap->pool[heap->root].priority, heap->root };
+  return result;
+}
+
+HeapNode pairingExtractMin(PairingHeap* heap)
+{
+  HeapNode result = pairingGetMin(heap);
+  PairingNode* root = &heap->pool[heap->root];
+  heap->root = mergePairs(heap->pool, root->child);
+  root->prev = DETACHED;
+  heap->size -= 1;
+  return result;
+}
+
+bool pairingInsert(PairingHeap* heap, int priority, int id)
+{
+  if (id >= heap->capacity && !growPool(heap, id))
+  {
+    return false;
+  }
+  PairingNode* node = &heap->pool[id];
+  if (node->prev != DETACHED)
+  {
+    return false;
+  }
+  node->priority = priority;
+  node->child = NOTHING;
+  node->sibling = NOTHING;
+  node->prev = NOTHING;
+  heap->root = (heap->root == NOTHING) ? id
+                                       : linkTrees(heap->pool, heap->root, id);
+  heap->size += 1;
+  return true;
+}
+
+int pairingGetPriority(PairingHeap* heap, int id)
+{
+  return heap->pool[id].priority;
+}
+
+bool pairingContains(PairingHeap* heap, int id)
+{
+  return id >= 0 && id < heap->capacity && heap->pool[id].prev != DETACHED;
+}
+
+bool pairingDecreasePriority(PairingHeap* heap, int id, int newPriority)
+{
+  if (!pairingContains(heap, id) || heap->pool[id].priority <= newPriority)
+  {
+    return false;
+  }
+  heap->pool[id].priority = newPriority;
+  // the subtree of 'id' is still a heap; only its parent may be larger now
+  if (id != heap->root)
+  {
+    cutTree(heap->pool, id);
+    heap->root = linkTrees(heap->pool, heap->root, id);
+  }
+  return true;
+}
+
+bool pairingChangePriority(PairingHeap* heap, int id, int newPriority)
+{
+  if (!pairingContains(heap, id))
+  {
+    return false;
+  }
+  if (newPriority <= heap->pool[id].priority)
+  {
+    pairingDecreasePriority(heap, id, newPriority);
+    return true;
+  }
+  // the children of 'id' may now be smaller than it: take it out, put its
+  // children back in its place, and insert it again alone
+  PairingNode* pool = heap->pool;
+  if (id != heap->root)
+  {
+    cutTree(pool, id);
+  }
+  int children = mergePairs(pool, pool[id].child);
+  if (id == heap->root)
+  {
+    heap->root = children;
+  }
+  else if (children != NOTHING)
+  {
+    heap->root = linkTrees(pool, heap->root, children);
+  }
+  pool[id].priority = newPriority;
+  pool[id].child = NOTHING;
+  pool[id].prev = NOTHING;
+  heap->root = (heap->root == NOTHING) ? id : linkTrees(pool, heap->root, id);
+  return true;
+}
+
+void deletePairingHeap(PairingHeap* heap)
+{
+  free(heap->pool);
+  free(heap);
+}
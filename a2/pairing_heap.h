@@ -0,0 +1,97 @@
+/*
+ * Header file for the PairingHeap.
+ *
+ * A priority queue with the API of the a3 MinHeap (nodes are addressed by
+ * ID, and IDs are dense: 0 <= id < capacity), built as a pairing heap
+ * instead of an array. Insert and decreasePriority only link two trees,
+ * in O(1); extractMin pairs up the children of the root, left to right,
+ * and then merges the pairs right to left, in O(log n) amortized. That
+ * makes it a good fit for graph searches, which decrease far more
+ * priorities than they extract.
+ *
+ * The nodes live in a pool indexed by ID and link to each other by ID, so
+ * the heap never allocates per operation; the pool grows when an ID does
+ * not fit.
+ */
+
+#include "minheap.h"
+
+#ifndef __PairingHeap_header
+#define __PairingHeap_header
+
+typedef struct pairing_node {
+  int priority;  // priority of this node
+  int child;     // ID of the leftmost child, NOTHING if none
+  int sibling;   // ID of the next sibling to the right, NOTHING if none
+  int prev;      // ID of the left sibling, or of the parent if leftmost;
+                 // NOTHING for the root, DETACHED if not in the heap
+} PairingNode;
+
+typedef struct pairing_heap {
+  int size;           // the number of nodes in this heap
+  int capacity;       // the number of IDs the pool has room for
+  int root;           // ID of the root, NOTHING if the heap is empty
+  PairingNode* pool;  // pool[id] is the node with ID id
+} PairingHeap;
+
+#define DETACHED -2
+
+/*
+ * Returns a newly created empty pairing heap for IDs 0 to 'capacity'-1,
+ * or NULL if out of memory.
+ * Precondition: capacity >= 0
+ */
+PairingHeap* newPairingHeap(int capacity);
+
+/*
+ * Returns the node with minimum priority in 'heap'.
+ * Precondition: 'heap' is non-empty
+ */
+HeapNode pairingGetMin(PairingHeap* heap);
+
+/*
+ * Removes and returns the node with minimum priority in 'heap'.
+ * Precondition: 'heap' is non-empty
+ */
+HeapNode pairingExtractMin(PairingHeap* heap);
+
+/*
+ * Inserts a new node with priority 'priority' and ID 'id' into 'heap',
+ * growing the pool if 'id' does not fit.
+ * Returns: true if successful, false if 'id' is already in 'heap' or out
+ *   of memory
+ * Precondition: id >= 0
+ */
+bool pairingInsert(PairingHeap* heap, int priority, int id);
+
+/*
+ * Returns the priority of the node with ID 'id' in 'heap'.
+ * Precondition: 'id' is in 'heap'
+ */
+int pairingGetPriority(PairingHeap* heap, int id);
+
+/*
+ * Returns: true if 'heap' has a node with ID 'id', false otherwise
+ */
+bool pairingContains(PairingHeap* heap, int id);
+
+/*
+ * Sets priority of node with ID 'id' in 'heap' to 'newPriority', if such
+ * a node exists in 'heap' and its priority is larger than 'newPriority',
+ * and returns true. Has no effect and returns false, otherwise.
+ */
+bool pairingDecreasePriority(PairingHeap* heap, int id, int newPriority);
+
+/*
+ * Sets priority of node with ID 'id' in 'heap' to 'newPriority', up or
+ * down. An increase costs as much as removing and reinserting the node.
+ * Returns: true if 'heap' has such a node, false otherwise
+ */
+bool pairingChangePriority(PairingHeap* heap, int id, int newPriority);
+
+/*
+ * Frees all memory allocated for 'heap'.
+ */
+void deletePairingHeap(PairingHeap* heap);
+
+#endif
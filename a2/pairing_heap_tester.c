@@ -0,0 +1,183 @@
+/*
+ * Model test of the PairingHeap: random operations are applied both to a
+ * heap and to a plain array of priorities, and the results are compared
+ * after every step. Priority changes go up as well as down and hit the
+ * root as well as inner nodes, so both the cutTree path and the increase
+ * path of pairingChangePriority are covered; after each one the links of
+ * the whole tree are checked.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pairing_heap.h"
+
+#define NUM_IDS 3000
+#define NUM_STEPS 300000
+#define MAX_PRIORITY 5000
+
+int priorities[NUM_IDS];  // priorities[id] is the priority of node 'id'
+bool inHeap[NUM_IDS];     // inHeap[id] is true if node 'id' is in the heap
+int count = 0;            // the number of nodes in the heap
+int stack[NUM_IDS];       // nodes still to visit in checkStructure
+
+/*
+ * Returns: true if the tree of 'heap' holds exactly the nodes of the
+ *   model, with their priorities, in heap order, and every 'prev' link
+ *   points back to the parent or left sibling
+ */
+bool checkStructure(PairingHeap* heap)
+{
+  PairingNode* pool = heap->pool;
+  if (heap->root == NOTHING)
+  {
+    return count == 0;
+  }
+  if (pool[heap->root].prev != NOTHING || pool[heap->root].sibling != NOTHING)
+  {
+    return false;
+  }
+  int visited = 0;
+  int depth = 0;
+  stack[depth++] = heap->root;
+  while (depth > 0)
+  {
+    int id = stack[--depth];
+    if (id < 0 || id >= NUM_IDS || !inHeap[id] ||
+        pool[id].priority != priorities[id] || ++visited > count)
+    {
+      return false;
+    }
+    int prev = id;
+    for (int child = pool[id].child; child != NOTHING;
+         child = pool[child].sibling)
+    {
+      if (pool[child].prev != prev ||
+          pool[child].priority < pool[id].priority || depth == NUM_IDS)
+      {
+        return false;
+      }
+      stack[depth++] = child;
+      prev = child;
+    }
+  }
+  return visited == count;
+}
+
+// Returns the minimum priority of the model, or MAX_PRIORITY if empty.
+int modelMin()
+{
+  int min = MAX_PRIORITY;
+  for (int id = 0; id < NUM_IDS; id++)
+  {
+    if (inHeap[id] && priorities[id] < min)
+    {
+      min = priorities[id];
+    }
+  }
+  return min;
+}
+
+/*
+ * Applies one random operation to 'heap' and the model.
+ * Returns: true if 'heap' behaved as the model predicts
+ */
+bool randomStep(PairingHeap* heap)
+{
+  int id = rand() % NUM_IDS;
+  int priority = rand() % MAX_PRIORITY;
+  switch (rand() % 6)
+  {
+  case 0:
+  case 1:
+    if (pairingInsert(heap, priority, id) == inHeap[id])
+    {
+      return false;
+    }
+    if (!inHeap[id])
+    {
+      inHeap[id] = true;
+      priorities[id] = priority;
+      count++;
+    }
+    return true;
+  case 2:
+  {
+    bool expected = inHeap[id] && priority < priorities[id];
+    if (pairingDecreasePriority(heap, id, priority) != expected)
+    {
+      return false;
+    }
+    if (expected)
+    {
+      priorities[id] = priority;
+    }
+    return checkStructure(heap);
+  }
+  case 3:
+    // half of the changes go to the root, whose children then take over
+    if (heap->root != NOTHING && rand() % 2 == 0)
+    {
+      id = heap->root;
+    }
+    if (pairingChangePriority(heap, id, priority) != inHeap[id])
+    {
+      return false;
+    }
+    if (inHeap[id])
+    {
+      priorities[id] = priority;
+    }
+    return checkStructure(heap);
+  default:
+  {
+    if (heap->size == 0)
+    {
+      return true;
+    }
+    HeapNode node = pairingExtractMin(heap);
+    if (!inHeap[node.id] || priorities[node.id] != node.priority ||
+        node.priority != modelMin())
+    {
+      return false;
+    }
+    inHeap[node.id] = false;
+    count--;
+    return true;
+  }
+  }
+}
+
+int main()
+{
+  srand(9);
+  PairingHeap* heap = newPairingHeap(0);
+  if (heap == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  // no int capacity can hold INT_MAX, so that ID must be refused
+  if (pairingInsert(heap, 0, INT_MAX) || heap->size != 0)
+  {
+    printf("FAILED to refuse ID INT_MAX\n");
+    deletePairingHeap(heap);
+    return 1;
+  }
+  for (int step = 0; step < NUM_STEPS; step++)
+  {
+    int id = rand() % NUM_IDS;
+    if (!randomStep(heap) || heap->size != count ||
+        pairingContains(heap, id) != inHeap[id] ||
+        (inHeap[id] && pairingGetPriority(heap, id) != priorities[id]))
+    {
+      printf("FAILED at step %d\n", step);
+      deletePairingHeap(heap);
+      return 1;
+    }
+  }
+  bool ok = checkStructure(heap);
+  deletePairingHeap(heap);
+  printf(ok ? "All pairing heap tests passed\n" : "FAILED at the end\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/*
+ * Hardware performance counters through perf_event_open.
+ */
+
+#include <string.h>
+
+#include "perf_counters.h"
+
+const char* perfEventNames[PERF_NUM_EVENTS] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"
+};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// What the kernel reports for one event with the read format below.
+typedef struct perf_reading {
+    unsigned long long value;
+    unsigned long long timeEnabled;
+    unsigned long long timeRunning;
+} PerfReading;
+
+// Opens one event for the calling thread on any CPU, stopped.
+int openEvent(unsigned type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// The config of a read miss in cache 'cache'.
+unsigned long long cacheMiss(unsigned long long cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+bool perfOpen(PerfCounters* counters) {
+    counters->fds[PERF_CYCLES] =
+        openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[PERF_INSTRUCTIONS] =
+        openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[PERF_BRANCH_MISSES] =
+        openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    counters->fds[PERF_L1D_MISSES] =
+        openEvent(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D));
+    counters->fds[PERF_LLC_MISSES] =
+        openEvent(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL));
+
+    bool any = false;
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (counters->fds[i] < 0) {
+            counters->fds[i] = -1;
+        } else {
+            any = true;
+        }
+    }
+    return any;
+}
+
+void perfStart(PerfCounters* counters) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perfStop(PerfCounters* counters, long long counts[PERF_NUM_EVENTS]) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        PerfReading reading;
+        counts[i] = -1;
+        if (counters->fds[i] < 0 ||
+            read(counters->fds[i], &reading, sizeof(reading)) != sizeof(reading)) {
+            continue;
+        }
+        // the event was multiplexed if it did not run the whole time
+        if (reading.timeRunning == 0) {
+            counts[i] = (reading.timeEnabled == 0) ? 0 : -1;
+        } else if (reading.timeRunning < reading.timeEnabled) {
+            counts[i] = (long long) ((double) reading.value *
+                                     reading.timeEnabled / reading.timeRunning);
+        } else {
+            counts[i] = (long long) reading.value;
+        }
+    }
+}
+
+void perfClose(PerfCounters* counters) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+}
+
+#else
+
+bool perfOpen(PerfCounters* counters) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        counters->fds[i] = -1;
+    }
+    return false;
+}
+
+void perfStart(PerfCounters* counters) {
+}
+
+void perfStop(PerfCounters* counters, long long counts[PERF_NUM_EVENTS]) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        counts[i] = -1;
+    }
+}
+
+void perfClose(PerfCounters* counters) {
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Header file for hardware performance counters, read through Linux's
+ * perf_event_open.
+ *
+ * Each event is opened on its own, for the calling thread, user space
+ * only, so that an event the CPU, kernel or container does not offer only
+ * loses that one column. When the kernel multiplexes more events than the
+ * CPU has counters, the counts are scaled up by enabled / running time.
+ * On other systems every event is unavailable.
+ */
+
+#include <stdbool.h>
+
+#ifndef __PerfCounters_header
+#define __PerfCounters_header
+
+typedef enum perf_event {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_NUM_EVENTS
+} PerfEvent;
+
+typedef struct perf_counters {
+    int fds[PERF_NUM_EVENTS];  // one file descriptor per event, -1 if unavailable
+} PerfCounters;
+
+// Short names of the events, indexed by PerfEvent, e.g. for CSV headers.
+extern const char* perfEventNames[PERF_NUM_EVENTS];
+
+/*
+ * Opens the counters of 'counters', stopped.
+ * Returns: true if at least one event is available, false otherwise
+ */
+bool perfOpen(PerfCounters* counters);
+
+/*
+ * Resets the counters of 'counters' to 0 and starts them.
+ */
+void perfStart(PerfCounters* counters);
+
+/*
+ * Stops the counters of 'counters' and stores their counts since perfStart
+ * in 'counts', indexed by PerfEvent; unavailable events get -1.
+ */
+void perfStop(PerfCounters* counters, long long counts[PERF_NUM_EVENTS]);
+
+/*
+ * Closes the counters of 'counters'.
+ */
+void perfClose(PerfCounters* counters);
+
+#endif
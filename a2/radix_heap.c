@@ -0,0 +1,290 @@
+/*
+ * RadixHeap implementation.
+ */
+
+#include <string.h>
+
+#include "id_array.h"
+#include "radix_heap.h"
+
+/*************************************************************************
+ ** Helper functions
+ *************************************************************************/
+
+/*
+ * Returns the bucket of 'priority' relative to the last extracted
+ * priority 'last'.
+ * Precondition: priority >= last >= 0
+ */
+static inline int bucketOf(int priority, int last)
+{
+  return (priority == last) ? 0 : 32 - __builtin_clz(priority ^ last);
+}
+
+/*
+ * Appends entry 'node' to bucket 'bucket', growing it by doubling.
+ * Returns: true if successful, false otherwise (out of memory)
+ */
+bool pushEntry(RadixBucket* bucket, HeapNode node)
+{
+  if (bucket->size == bucket->capacity)
+  {
+    int capacity = (bucket->capacity > 0) ? 2 * bucket->capacity : 16;
+    HeapNode* entries = (HeapNode*) realloc(bucket->entries,
+        sizeof(HeapNode) * (size_t) capacity);
+    if (entries == NULL)
+    {
+      return false;
+    }
+    bucket->entries = entries;
+    bucket->capacity = capacity;
+  }
+  bucket->entries[bucket->size++] = node;
+  return true;
+}
+
+/*
+ * Adds an entry for node 'id' with priority 'priority' to its bucket.
+ * Returns: true if successful, false otherwise (out of memory)
+ */
+bool addEntry(RadixHeap* heap, int priority, int id)
+{
+  HeapNode node = { priority, id };
+  if (!pushEntry(&heap->buckets[bucketOf(priority, heap->last)], node))
+  {
+    return false;
+  }
+  heap->entries += 1;
+  return true;
+}
+
+/*
+ * Returns: true if 'node' is the current entry of its ID, false if it is
+ *   stale (the ID was extracted or got another priority since). Without
+ *   stale entries, the random access to 'priorities' is skipped.
+ */
+static inline bool isCurrent(RadixHeap* heap, HeapNode node)
+{
+  return heap->entries == heap->size ||
+         heap->priorities[node.id] == node.priority;
+}
+
+/*
+ * Undoes the redistribution of bucket 'b', which ran out of memory at its
+ * entry 'failed': the entries already moved to lower buckets (all empty
+ * before) go back to the front of bucket 'b', followed by the entries not
+ * moved yet. Each moved entry was read from before 'failed', so they fit.
+ */
+void undoRedistribution(RadixHeap* heap, int b, int failed)
+{
+  RadixBucket* bucket = &heap->buckets[b];
+  int moved = 0;
+  for (int lower = 0; lower < b; lower++)
+  {
+    RadixBucket* from = &heap->buckets[lower];
+    if (from->size > 0)
+    {
+      memcpy(bucket->entries + moved, from->entries,
+          sizeof(HeapNode) * (size_t) from->size);
+      moved += from->size;
+      from->size = 0;
+    }
+  }
+  memmove(bucket->entries + moved, bucket->entries + failed,
+      sizeof(HeapNode) * (size_t) (bucket->size - failed));
+  bucket->size = moved + bucket->size - failed;
+}
+
+/*
+ * Returns the bucket whose last entry is a current entry of the minimum
+ * priority. Stale entries on top of bucket 0 are dropped, and while it is
+ * empty, the minimum of the lowest non-empty bucket becomes 'last' and
+ * that bucket is redistributed, dropping its stale entries; the result is
+ * then bucket 0. If redistributing runs out of memory, it is undone and
+ * the minimum is moved to the top of its own bucket instead, leaving
+ * 'last' as it was, so the heap stays correct and just does more work.
+ * Precondition: 'heap' is non-empty
+ */
+RadixBucket* settle(RadixHeap* heap)
+{
+  RadixBucket* zero = &heap->buckets[0];
+  for (;;)
+  {
+    while (zero->size > 0 && !isCurrent(heap, zero->entries[zero->size - 1]))
+    {
+      zero->size--;
+      heap->entries -= 1;
+    }
+    if (zero->size > 0)
+    {
+      return zero;
+    }
+
+    int b = 1;
+    while (heap->buckets[b].size == 0)
+    {
+      b++;
+    }
+    RadixBucket* bucket = &heap->buckets[b];
+    int min = NOTHING;
+    for (int i = 0; i < bucket->size; i++)
+    {
+      HeapNode node = bucket->entries[i];
+      if (isCurrent(heap, node) && (min == NOTHING || node.priority < min))
+      {
+        min = node.priority;
+      }
+    }
+    // a bucket of stale entries only is simply emptied
+    if (min == NOTHING)
+    {
+      heap->entries -= bucket->size;
+      bucket->size = 0;
+      continue;
+    }
+
+    int last = heap->last;
+    heap->last = min;
+    for (int i = 0; i < bucket->size; i++)
+    {
+      HeapNode node = bucket->entries[i];
+      if (!isCurrent(heap, node))
+      {
+        heap->entries -= 1;
+      }
+      else if (!pushEntry(&heap->buckets[bucketOf(node.priority, min)], node))
+      {
+        undoRedistribution(heap, b, i);
+        heap->last = last;
+        int top = 0;
+        while (!isCurrent(heap, bucket->entries[top]) ||
+               bucket->entries[top].priority != min)
+        {
+          top++;
+        }
+        HeapNode swap = bucket->entries[top];
+        bucket->entries[top] = bucket->entries[bucket->size - 1];
+        bucket->entries[bucket->size - 1] = swap;
+        return bucket;
+      }
+    }
+    bucket->size = 0;
+  }
+}
+
+/*
+ * Grows 'priorities' of 'heap', at least doubling it, so that 'id' fits.
+ * Returns: true if successful, false otherwise ('heap' is unchanged)
+ */
+bool growPriorities(RadixHeap* heap, int id)
+{
+  int capacity = heap->capacity;
+  int* priorities = (int*) growIdArray(heap->priorities, sizeof(int),
+      &capacity, id);
+  if (priorities == NULL)
+  {
+    return false;
+  }
+  for (int i = heap->capacity; i < capacity; i++)
+  {
+    priorities[i] = NOTHING;
+  }
+  heap->priorities = priorities;
+  heap->capacity = capacity;
+  return true;
+}
+
+/*************************************************************************
+ ** Heap operations
+ *************************************************************************/
+
+RadixHeap* newRadixHeap(int capacity)
+{
+  RadixHeap* heap = (RadixHeap*) calloc(1, sizeof(RadixHeap));
+  if (heap == NULL)
+  {
+    return NULL;
+  }
+  if (capacity > 0 && !growPriorities(heap, capacity - 1))
+  {
+    free(heap);
+    return NULL;
+  }
+  return heap;
+}
+
+HeapNode radixGetMin(RadixHeap* heap)
+{
+  RadixBucket* bucket = settle(heap);
+  return bucket->entries[bucket->size - 1];
+}
+
+HeapNode radixExtractMin(RadixHeap* heap)
+{
+  RadixBucket* bucket = settle(heap);
+  HeapNode result = bucket->entries[--bucket->size];
+  heap->entries -= 1;
+  heap->priorities[result.id] = NOTHING;
+  heap->size -= 1;
+  return result;
+}
+
+bool radixInsert(RadixHeap* heap, int priority, int id)
+{
+  if (priority < heap->last ||
+      (id >= heap->capacity && !growPriorities(heap, id)) ||
+      heap->priorities[id] != NOTHING || !addEntry(heap, priority, id))
+  {
+    return false;
+  }
+  heap->priorities[id] = priority;
+  heap->size += 1;
+  return true;
+}
+
+int radixGetPriority(RadixHeap* heap, int id)
+{
+  return heap->priorities[id];
+}
+
+bool radixContains(RadixHeap* heap, int id)
+{
+  return id >= 0 && id < heap->capacity && heap->priorities[id] != NOTHING;
+}
+
+bool radixDecreasePriority(RadixHeap* heap, int id, int newPriority)
+{
+  if (!radixContains(heap, id) || heap->priorities[id] <= newPriority)
+  {
+    return false;
+  }
+  return radixChangePriority(heap, id, newPriority);
+}
+
+bool radixChangePriority(RadixHeap* heap, int id, int newPriority)
+{
+  if (!radixContains(heap, id) || newPriority < heap->last)
+  {
+    return false;
+  }
+  // the old entry goes stale once the priority no longer matches it
+  if (newPriority != heap->priorities[id])
+  {
+    if (!addEntry(heap, newPriority, id))
+    {
+      return false;
+    }
+    heap->priorities[id] = newPriority;
+  }
+  return true;
+}
+
+void deleteRadixHeap(RadixHeap* heap)
+{
+  for (int b = 0; b < RADIX_BUCKETS; b++)
+  {
+    free(heap->buckets[b].entries);
+  }
+  free(heap->priorities);
+  free(heap);
+}
@@ -0,0 +1,110 @@
+/*
+ * Header file for the RadixHeap.
+ *
+ * A priority queue for non-negative int priorities that never go below the
+ * last extracted one (monotone), as in Dijkstra's algorithm or a timer
+ * wheel. Its API is that of the a3 MinHeap (nodes are addressed by ID,
+ * and IDs are dense: 0 <= id < capacity).
+ *
+ * Nodes are kept in 32 buckets by the highest bit in which their priority
+ * differs from the last extracted priority, 'last': bucket 0 holds
+ * priorities equal to 'last', bucket b those that first differ in bit b-1.
+ * extractMin empties bucket 0 first; when it is empty, the lowest
+ * non-empty bucket is scanned for its minimum, which becomes 'last', and
+ * its nodes are redistributed into lower buckets. A node only ever moves
+ * down, so each costs O(log C) amortized for priorities below C, and all
+ * the work is sequential scans of small arrays, without comparisons
+ * between nodes.
+ *
+ * Priority changes are lazy: the current priority of every ID is kept in
+ * 'priorities', and a change just adds a new entry for the ID. Entries
+ * that no longer match are dropped when their bucket is scanned.
+ */
+
+#include "minheap.h"
+
+#ifndef __RadixHeap_header
+#define __RadixHeap_header
+
+#define RADIX_BUCKETS 32
+
+typedef struct radix_bucket {
+  int size;       // the number of entries in this bucket
+  int capacity;   // the number of entries that fit in 'entries'
+  HeapNode* entries;
+} RadixBucket;
+
+typedef struct radix_heap {
+  int size;          // the number of nodes in this heap
+  int capacity;      // the number of IDs 'priorities' has room for
+  int last;          // the last extracted priority, 0 at first
+  long long entries; // the number of entries in all buckets; when it equals
+                     // 'size', none is stale
+  int* priorities;   // priorities[id] is the priority of node 'id', or
+                     // NOTHING if it is not in the heap
+  RadixBucket buckets[RADIX_BUCKETS];
+} RadixHeap;
+
+/*
+ * Returns a newly created empty radix heap for IDs 0 to 'capacity'-1, or
+ * NULL if out of memory.
+ * Precondition: capacity >= 0
+ */
+RadixHeap* newRadixHeap(int capacity);
+
+/*
+ * Returns the node with minimum priority in 'heap'. May reorganize the
+ * buckets, hence the non-const 'heap'.
+ * Precondition: 'heap' is non-empty
+ */
+HeapNode radixGetMin(RadixHeap* heap);
+
+/*
+ * Removes and returns the node with minimum priority in 'heap'. Its
+ * priority becomes the lower bound of all priorities inserted from now on
+ * (out of memory, the bound may stay at an earlier minimum instead).
+ * Precondition: 'heap' is non-empty
+ */
+HeapNode radixExtractMin(RadixHeap* heap);
+
+/*
+ * Inserts a new node with priority 'priority' and ID 'id' into 'heap',
+ * growing it if 'id' does not fit.
+ * Returns: true if successful, false if 'id' is already in 'heap',
+ *   'priority' is below the last extracted priority, or out of memory
+ * Precondition: id >= 0
+ */
+bool radixInsert(RadixHeap* heap, int priority, int id);
+
+/*
+ * Returns the priority of the node with ID 'id' in 'heap'.
+ * Precondition: 'id' is in 'heap'
+ */
+int radixGetPriority(RadixHeap* heap, int id);
+
+/*
+ * Returns: true if 'heap' has a node with ID 'id', false otherwise
+ */
+bool radixContains(RadixHeap* heap, int id);
+
+/*
+ * Sets priority of node with ID 'id' in 'heap' to 'newPriority', if such
+ * a node exists in 'heap', its priority is larger than 'newPriority' and
+ * 'newPriority' is not below the last extracted priority, and returns
+ * true. Has no effect and returns false, otherwise.
+ */
+bool radixDecreasePriority(RadixHeap* heap, int id, int newPriority);
+
+/*
+ * Sets priority of node with ID 'id' in 'heap' to 'newPriority', up or
+ * down, if 'newPriority' is not below the last extracted priority.
+ * Returns: true if successful, false otherwise
+ */
+bool radixChangePriority(RadixHeap* heap, int id, int newPriority);
+
+/*
+ * Frees all memory allocated for 'heap'.
+ */
+void deleteRadixHeap(RadixHeap* heap);
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * Model test of the RadixHeap: random monotone operations are applied both
+ * to a heap and to a plain array of priorities, and the results are
+ * compared after every step. After every extraction the buckets are
+ * checked in full: every node has a current entry in the right bucket,
+ * 'entries' counts them all, and 'entries == size' holds exactly when no
+ * entry is stale, which is what lets isCurrent skip the lookup.
+ *
+ * The tester is linked with realloc wrapped (see the Makefile), so that a
+ * last phase can make allocations fail and check that the heap stays
+ * correct when a bucket cannot grow.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "radix_heap.h"
+
+#define NUM_IDS 3000
+#define NUM_STEPS 300000
+#define NUM_FAILING_STEPS 100000
+#define PRIORITY_SPREAD 5000
+
+int priorities[NUM_IDS];  // priorities[id] is the priority of node 'id'
+bool inHeap[NUM_IDS];     // inHeap[id] is true if node 'id' is in the heap
+int count = 0;            // the number of nodes in the heap
+int last = 0;             // the last extracted priority
+int currentEntries[NUM_IDS];  // scratch for checkBuckets
+bool failRealloc = false;     // make about half of all reallocs fail
+int laggingExtractions = 0;   // extractions that could not raise 'last'
+
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+  if (failRealloc && rand() % 2 == 0)
+  {
+    return NULL;
+  }
+  return __real_realloc(pointer, size);
+}
+
+/*
+ * Returns: true if the buckets of 'heap' hold a current entry, in the
+ *   right bucket, for every node of the model, 'entries' is the number of
+ *   entries in all buckets, and it equals 'size' exactly when none is
+ *   stale or a duplicate
+ */
+bool checkBuckets(RadixHeap* heap)
+{
+  for (int id = 0; id < NUM_IDS; id++)
+  {
+    currentEntries[id] = 0;
+  }
+  long long entries = 0;
+  long long stale = 0;
+  for (int b = 0; b < RADIX_BUCKETS; b++)
+  {
+    RadixBucket* bucket = &heap->buckets[b];
+    entries += bucket->size;
+    for (int i = 0; i < bucket->size; i++)
+    {
+      HeapNode node = bucket->entries[i];
+      if (node.id >= heap->capacity ||
+          heap->priorities[node.id] != node.priority)
+      {
+        stale++;
+        continue;
+      }
+      int want = (node.priority == heap->last)
+                     ? 0 : 32 - __builtin_clz(node.priority ^ heap->last);
+      if (want != b)
+      {
+        return false;
+      }
+      currentEntries[node.id]++;
+    }
+  }
+  long long duplicates = 0;
+  for (int id = 0; id < NUM_IDS; id++)
+  {
+    if ((currentEntries[id] > 0) != inHeap[id])
+    {
+      return false;
+    }
+    if (currentEntries[id] > 1)
+    {
+      duplicates += currentEntries[id] - 1;
+    }
+  }
+  return entries == heap->entries &&
+         (heap->entries == heap->size) == (stale == 0 && duplicates == 0);
+}
+
+// Returns the minimum priority of the model; the model must be non-empty.
+int modelMin()
+{
+  int min = NOTHING;
+  for (int id = 0; id < NUM_IDS; id++)
+  {
+    if (inHeap[id] && (min == NOTHING || priorities[id] < min))
+    {
+      min = priorities[id];
+    }
+  }
+  return min;
+}
+
+/*
+ * Extracts the minimum of 'heap' and checks it against the model.
+ * Returns: true if 'heap' behaved as the model predicts
+ */
+bool extractAndCheck(RadixHeap* heap)
+{
+  HeapNode min = radixGetMin(heap);
+  HeapNode node = radixExtractMin(heap);
+  if (node.id != min.id || node.priority != min.priority ||
+      !inHeap[node.id] || priorities[node.id] != node.priority ||
+      node.priority != modelMin())
+  {
+    return false;
+  }
+  inHeap[node.id] = false;
+  count--;
+  last = node.priority;
+  // out of memory, the heap may keep an earlier lower bound
+  if (heap->last != last)
+  {
+    laggingExtractions++;
+  }
+  return heap->last <= last && checkBuckets(heap);
+}
+
+/*
+ * Applies one random operation to 'heap' and the model. Inserts and
+ * priority changes may fail only while reallocs do, and must then leave
+ * the node as it was.
+ * Returns: true if 'heap' behaved as the model predicts
+ */
+bool randomStep(RadixHeap* heap)
+{
+  int id = rand() % NUM_IDS;
+  int operation = rand() % 7;
+  // mostly near 'last', sometimes equal to it, sometimes below it
+  int priority = last + rand() % ((operation == 6) ? 3 : PRIORITY_SPREAD);
+  if (rand() % 50 == 0)
+  {
+    priority = last - 1 - rand() % 5;
+  }
+  // below the model's 'last', but not the heap's, is not checked
+  if (priority < last && priority >= heap->last)
+  {
+    return true;
+  }
+
+  bool result;
+  bool expected;
+  switch (operation)
+  {
+  case 0:
+  case 1:
+  case 6:
+    result = radixInsert(heap, priority, id);
+    expected = !inHeap[id] && priority >= last;
+    break;
+  case 2:
+    result = radixDecreasePriority(heap, id, priority);
+    expected = inHeap[id] && priority < priorities[id] && priority >= last;
+    break;
+  case 3:
+    result = radixChangePriority(heap, id, priority);
+    expected = inHeap[id] && priority >= last;
+    break;
+  default:
+    return heap->size == 0 || extractAndCheck(heap);
+  }
+  if (result != expected && !(failRealloc && expected))
+  {
+    return false;
+  }
+  if (result)
+  {
+    count += !inHeap[id];
+    inHeap[id] = true;
+    priorities[id] = priority;
+  }
+  return true;
+}
+
+/*
+ * Runs 'steps' random steps on 'heap'.
+ * Returns: true if 'heap' behaved as the model predicts throughout
+ */
+bool runSteps(RadixHeap* heap, int steps)
+{
+  for (int step = 0; step < steps; step++)
+  {
+    int id = rand() % NUM_IDS;
+    if (!randomStep(heap) || heap->size != count ||
+        radixContains(heap, id) != inHeap[id] ||
+        (inHeap[id] && radixGetPriority(heap, id) != priorities[id]))
+    {
+      printf("FAILED at step %d\n", step);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * A stale entry comes back to life when its ID is inserted again with the
+ * same priority, so that ID has two current entries for a while.
+ * Returns: true if the duplicate is extracted only once
+ */
+bool testRevivedEntry()
+{
+  RadixHeap* heap = newRadixHeap(8);
+  bool ok = radixInsert(heap, 200, 7) && radixDecreasePriority(heap, 7, 100);
+  // (200, 7) is now stale, in a higher bucket than (100, 7)
+  ok = ok && radixExtractMin(heap).priority == 100 && heap->entries == 1;
+  ok = ok && radixInsert(heap, 200, 7) && heap->entries == 2 &&
+       heap->size == 1;
+  HeapNode node = radixExtractMin(heap);
+  ok = ok && node.id == 7 && node.priority == 200 && heap->size == 0 &&
+       !radixContains(heap, 7);
+  // the other (200, 7) is stale again, and must not hide a later entry
+  ok = ok && radixInsert(heap, 300, 7) && radixInsert(heap, 250, 3);
+  ok = ok && radixExtractMin(heap).id == 3 && radixExtractMin(heap).id == 7 &&
+       heap->size == 0 && heap->entries == 0;
+  deleteRadixHeap(heap);
+  return ok;
+}
+
+/*
+ * Returns: true if INT_MAX works as a priority (it is not a sentinel), but
+ *   is refused as an ID, which no int capacity can hold
+ */
+bool testLargestPriority()
+{
+  RadixHeap* heap = newRadixHeap(4);
+  bool ok = !radixInsert(heap, 0, INT_MAX) && heap->capacity == 4;
+  ok = ok && radixInsert(heap, INT_MAX, 0) && radixInsert(heap, 0, 1);
+  ok = ok && radixExtractMin(heap).priority == 0 &&
+       radixExtractMin(heap).priority == INT_MAX && heap->size == 0;
+  deleteRadixHeap(heap);
+  return ok;
+}
+
+int main()
+{
+  srand(11);
+  if (!testRevivedEntry() || !testLargestPriority())
+  {
+    printf("FAILED in a fixed case\n");
+    return 1;
+  }
+
+  RadixHeap* heap = newRadixHeap(0);
+  bool ok = heap != NULL && runSteps(heap, NUM_STEPS);
+  while (ok && heap->size > 0)
+  {
+    ok = extractAndCheck(heap);
+  }
+  if (heap != NULL)
+  {
+    deleteRadixHeap(heap);
+  }
+
+  // Again from scratch, with about half of all reallocs failing, so that
+  // buckets cannot grow when redistributing into them.
+  last = 0;
+  heap = newRadixHeap(NUM_IDS);
+  failRealloc = true;
+  ok = ok && heap != NULL && runSteps(heap, NUM_FAILING_STEPS);
+  failRealloc = false;
+  while (ok && heap->size > 0)
+  {
+    ok = extractAndCheck(heap);
+  }
+  if (heap != NULL)
+  {
+    deleteRadixHeap(heap);
+  }
+  if (ok && laggingExtractions == 0)
+  {
+    printf("FAILED to hit a failing redistribution\n");
+    ok = false;
+  }
+
+  if (ok)
+  {
+    printf("All radix heap tests passed\n");
+  }
+  return ok ? 0 : 1;
+}
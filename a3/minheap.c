@@ -84,23 +84,73 @@ int priorityAt(MinHeap * heap, int nodeIndex) {
   return heap -> arr[nodeIndex].priority;
 }
 
+/*
+ * Moves 'node' up from index 'nodeIndex', which is treated as a hole: each
+ * parent with a larger priority is shifted down into the hole, and 'node'
+ * is stored once, where the hole ends up. The index map follows every
+ * node that moves.
+ * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
+ */
+void siftUp(MinHeap * heap, int nodeIndex, HeapNode node) {
+  HeapNode * arr = heap -> arr;
+  int * indexMap = heap -> indexMap;
+  while (nodeIndex > ROOT_INDEX) {
+    int parent = getParentIdx(nodeIndex);
+    if (arr[parent].priority <= node.priority) {
+      break;
+    }
+    arr[nodeIndex] = arr[parent];
+    indexMap[arr[nodeIndex].id] = nodeIndex;
+    nodeIndex = parent;
+  }
+  arr[nodeIndex] = node;
+  indexMap[node.id] = nodeIndex;
+}
+
+/*
+ * Same as siftUp, but moving down: the smaller child is shifted up into
+ * the hole while it is smaller than 'node'.
+ * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
+ */
+void siftDown(MinHeap * heap, int nodeIndex, HeapNode node) {
+  HeapNode * arr = heap -> arr;
+  int * indexMap = heap -> indexMap;
+  int size = heap -> size;
+  int child;
+  // While both children exist, the comparison result picks the smaller one
+  // directly, so the compiler can avoid a hard-to-predict branch. That also
+  // stops the CPU from speculatively loading the next level, so we prefetch
+  // the great-grandchildren ourselves; large heaps are miss-bound otherwise.
+  while ((child = getLeftChildIdx(nodeIndex)) < size) {
+    // not '8 * nodeIndex <= size', which overflows in huge heaps
+    if (nodeIndex <= size / 8) {
+      __builtin_prefetch( & arr[8 * nodeIndex]);
+    }
+    child += arr[child + 1].priority < arr[child].priority;
+    if (arr[child].priority >= node.priority) {
+      break;
+    }
+    arr[nodeIndex] = arr[child];
+    indexMap[arr[nodeIndex].id] = nodeIndex;
+    nodeIndex = child;
+  }
+  // the last parent may have a left child only
+  if (child == size && arr[child].priority < node.priority) {
+    arr[nodeIndex] = arr[child];
+    indexMap[arr[nodeIndex].id] = nodeIndex;
+    nodeIndex = child;
+  }
+  arr[nodeIndex] = node;
+  indexMap[node.id] = nodeIndex;
+}
+
 /*
  * Floats up the element at index 'nodeIndex' in minheap 'heap' such that
  * 'heap' is still a minheap.
  * Precondition: 'nodeIndex' is a valid index of minheap 'heap'
  */
 void floatUp(MinHeap * heap, int nodeIndex) {
-  // check if the nodeIndex is valid
-  if (isValidIndex(heap, getParentIdx(nodeIndex))) {
-    // check if the priority of the nodeIndex is smaller than the priority of the parent
-    if (priorityAt(heap, nodeIndex) < priorityAt(heap, getParentIdx(nodeIndex))) {
-      // swap the nodeIndex and the parent
-      // check the parent (which was the nodeIndex) and the parent's parent again
-      swap(heap, nodeIndex, getParentIdx(nodeIndex));
-      floatUp(heap, getParentIdx(nodeIndex));
-    }
-  }
-  return;
+  siftUp(heap, nodeIndex, heap -> arr[nodeIndex]);
 }
 
 /*
@@ -138,49 +188,22 @@ HeapNode getMin(MinHeap * heap) {
 }
 
 void heapify(MinHeap * heap, int nodeIndex) {
-  // check if there are two subtrees
-  if (isValidIndex(heap, getRightChildIdx(nodeIndex))) { // check if left < right
-    if (priorityAt(heap, getLeftChildIdx(nodeIndex)) < priorityAt(heap, getRightChildIdx(nodeIndex))) { // check if left < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getLeftChildIdx(nodeIndex))) {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getLeftChildIdx(nodeIndex));
-        heapify(heap, getLeftChildIdx(nodeIndex));
-      }
-    }
-    // if left > right
-    else { // check if right < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getRightChildIdx(nodeIndex))) {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getRightChildIdx(nodeIndex));
-        heapify(heap, getRightChildIdx(nodeIndex));
-      }
-    }
-  }
-  // if there is no right subtree
-  else { // check if there is left subtree
-    if (isValidIndex(heap, getLeftChildIdx(nodeIndex))) { // check if left < nodeIndex
-      if (priorityAt(heap, nodeIndex) > priorityAt(heap, getLeftChildIdx(nodeIndex))) {
-        // swap the nodeIndex and the smaller child
-        // check the child (which was the nodeIndex) and the child's children again
-        swap(heap, nodeIndex, getLeftChildIdx(nodeIndex));
-        heapify(heap, getLeftChildIdx(nodeIndex));
-      }
-    }
-  }
-  return;
+  siftDown(heap, nodeIndex, heap -> arr[nodeIndex]);
 }
 
 HeapNode extractMin(MinHeap * heap) {
   // store the min node
   HeapNode result = getMin(heap);
-  // swap the min node (the first node) with the last node
-  swap(heap, 1, heap -> size);
-  // decrease the size of the heap, indicating that the last node is no longer in the heap
+  // the last node leaves its slot and sinks from the root
+  HeapNode last = heap -> arr[heap -> size];
+  // the min node stays just past the end, where its index still points,
+  // so getPriority keeps working for extracted IDs
+  heap -> arr[heap -> size] = result;
+  heap -> indexMap[result.id] = heap -> size;
   heap -> size -= 1;
-  // adjust the place of the first node (which was the last node)
-  heapify(heap, 1);
+  if (heap -> size > 0) {
+    siftDown(heap, ROOT_INDEX, last);
+  }
 
   return result;
 }
@@ -190,16 +213,10 @@ bool insert(MinHeap * heap, int priority, int id) {
   if (heap -> size == heap -> capacity) {
     return false;
   }
-  // create a new node with given priorty and id
-  HeapNode * new_node = (HeapNode * ) malloc(sizeof(HeapNode));
-  new_node -> priority = priority;
-  new_node -> id = id;
-  // add the new node to the end of the array and update the heap size
+  // the new node rises from the first free slot
+  HeapNode node = { priority, id };
   heap -> size += 1;
-  heap -> arr[heap -> size] = * new_node;
-  heap -> indexMap[id] = heap -> size;
-  // float up the new node if necessary
-  floatUp(heap, heap -> size);
+  siftUp(heap, heap -> size, node);
 
   return true;
 }
@@ -214,11 +231,10 @@ bool decreasePriority(MinHeap * heap, int id, int newPriority) {
   }
 
   int nodeIndex = indexOf(heap, id);
-  // update the priority of the node at the given index
-  heap -> arr[nodeIndex].priority = newPriority;
-  // update the place of the node if necessary
-  floatUp(heap, nodeIndex);
-  heapify(heap, nodeIndex);
+  // a smaller priority can only move the node up
+  HeapNode node = heap -> arr[nodeIndex];
+  node.priority = newPriority;
+  siftUp(heap, nodeIndex, node);
   return true;
 }
 